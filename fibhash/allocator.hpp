@@ -0,0 +1,206 @@
+#ifndef FIBHASH_ALLOCATOR_HPP
+#define FIBHASH_ALLOCATOR_HPP
+
+#include "platform.hpp"
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+
+namespace fibhash {
+
+// Allocator handing out cache-line aligned blocks rounded up to whole cache
+// lines, so slot arrays never start mid-line or share a line with other data.
+// Blocks come zero-filled from calloc, which maps large blocks straight from
+// fresh zero pages, and value-initialising an element is a no-op. A vector
+// of n all-zero objects therefore costs no writes and no page faults until
+// the slots are used. Only use it for types whose zero bytes are a valid
+// value.
+template <typename T>
+struct CacheAlignedAllocator {
+    using value_type = T;
+    static constexpr const char* name = "CacheAligned";
+
+    CacheAlignedAllocator() = default;
+
+    template <typename U>
+    CacheAlignedAllocator(const CacheAlignedAllocator<U>&) {}
+
+    // Bytes actually reserved for n objects: whole cache lines, plus the
+    // extra line that leaves room to align the block
+    static size_t allocationSize(size_t n) {
+        return (n * sizeof(T) + cacheLineSize - 1) / cacheLineSize *
+                   cacheLineSize +
+               cacheLineSize;
+    }
+
+    // The offset back to the calloc'ed block is kept just before the
+    // aligned pointer
+    T* allocate(size_t n) {
+        void* raw = std::calloc(allocationSize(n), 1);
+        if (!raw) throw std::bad_alloc();
+        uintptr_t base = reinterpret_cast<uintptr_t>(raw);
+        uintptr_t aligned = (base + cacheLineSize) & ~(cacheLineSize - 1);
+        reinterpret_cast<unsigned char*>(aligned)[-1] =
+            static_cast<unsigned char>(aligned - base);
+        return reinterpret_cast<T*>(aligned);
+    }
+
+    void deallocate(T* p, size_t) {
+        unsigned char* aligned = reinterpret_cast<unsigned char*>(p);
+        std::free(aligned - aligned[-1]);
+    }
+
+    // Value-initialisation keeps the zero bytes calloc returned
+    template <typename U>
+    void construct(U*) noexcept {}
+
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args) {
+        ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+
+    template <typename U>
+    bool operator==(const CacheAlignedAllocator<U>&) const { return true; }
+
+    template <typename U>
+    bool operator!=(const CacheAlignedAllocator<U>&) const { return false; }
+};
+
+// Size of a transparent huge page on x86-64 and aarch64 Linux
+constexpr size_t hugePageSize = size_t(2) << 20;
+
+// Allocator for large tables that backs every block of at least one huge
+// page with huge-page aligned anonymous memory and asks the kernel to use
+// transparent huge pages for it, so random probes over a big slot array
+// miss the TLB far less often. Smaller blocks, and every block where mmap
+// is unavailable, come from CacheAlignedAllocator. Anonymous pages are zero
+// filled, so the same zero-bytes rule applies.
+template <typename T>
+struct HugePageAllocator {
+    using value_type = T;
+    static constexpr const char* name = "HugePage";
+
+    HugePageAllocator() = default;
+
+    template <typename U>
+    HugePageAllocator(const HugePageAllocator<U>&) {}
+
+    static bool useHugePages(size_t n) {
+#if defined(FIBHASH_HAVE_MMAP)
+        return n * sizeof(T) >= hugePageSize;
+#else
+        (void)n;
+        return false;
+#endif
+    }
+
+    // Bytes actually reserved for n objects
+    static size_t allocationSize(size_t n) {
+        if (!useHugePages(n)) return CacheAlignedAllocator<T>::allocationSize(n);
+        return (n * sizeof(T) + hugePageSize - 1) / hugePageSize * hugePageSize;
+    }
+
+    T* allocate(size_t n) {
+        if (!useHugePages(n)) return CacheAlignedAllocator<T>().allocate(n);
+#if defined(FIBHASH_HAVE_MMAP)
+        // Map one extra huge page and trim both ends so the block starts on
+        // a huge-page boundary
+        size_t length = allocationSize(n);
+        void* raw = ::mmap(nullptr, length + hugePageSize, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) throw std::bad_alloc();
+        uintptr_t base = reinterpret_cast<uintptr_t>(raw);
+        uintptr_t aligned = (base + hugePageSize - 1) & ~(hugePageSize - 1);
+        if (aligned != base) ::munmap(raw, aligned - base);
+        size_t tail = base + hugePageSize - aligned;
+        if (tail) ::munmap(reinterpret_cast<void*>(aligned + length), tail);
+#if defined(MADV_HUGEPAGE)
+        ::madvise(reinterpret_cast<void*>(aligned), length, MADV_HUGEPAGE);
+#endif
+        return reinterpret_cast<T*>(aligned);
+#else
+        return nullptr;
+#endif
+    }
+
+    void deallocate(T* p, size_t n) {
+        if (!useHugePages(n)) {
+            CacheAlignedAllocator<T>().deallocate(p, n);
+            return;
+        }
+#if defined(FIBHASH_HAVE_MMAP)
+        ::munmap(p, allocationSize(n));
+#endif
+    }
+
+    // Value-initialisation keeps the zero bytes of the fresh pages
+    template <typename U>
+    void construct(U*) noexcept {}
+
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args) {
+        ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+
+    template <typename U>
+    bool operator==(const HugePageAllocator<U>&) const { return true; }
+
+    template <typename U>
+    bool operator!=(const HugePageAllocator<U>&) const { return false; }
+};
+
+// Give the whole pages inside [p, p + bytes) back to the system while the
+// block stays allocated. The pages read as zeros afterwards, so this only
+// suits memory that is about to be freed, where it spreads the cost of
+// unmapping a large block over several calls.
+inline void releasePages(void* p, size_t bytes) {
+#if defined(FIBHASH_HAVE_MMAP) && defined(MADV_DONTNEED)
+    static const size_t pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    uintptr_t first = (reinterpret_cast<uintptr_t>(p) + pageSize - 1) &
+                      ~(pageSize - 1);
+    uintptr_t last = (reinterpret_cast<uintptr_t>(p) + bytes) & ~(pageSize - 1);
+    if (first < last)
+        ::madvise(reinterpret_cast<void*>(first), last - first, MADV_DONTNEED);
+#else
+    (void)p;
+    (void)bytes;
+#endif
+}
+
+// Name reported for an allocator in benchmark output
+template <typename Alloc, typename = void>
+struct AllocatorName {
+    static constexpr const char* value = "Std";
+};
+
+template <typename Alloc>
+struct AllocatorName<Alloc, std::void_t<decltype(Alloc::name)>> {
+    static constexpr const char* value = Alloc::name;
+};
+
+template <typename T>
+struct AllocatorName<std::pmr::polymorphic_allocator<T>> {
+    static constexpr const char* value = "Pmr";
+};
+
+// Bytes an allocator reserves for n objects; allocators that do not say
+// are assumed to reserve exactly what was asked for
+template <typename Alloc, typename = void>
+struct AllocationSize {
+    static size_t of(size_t n) { return n * sizeof(typename Alloc::value_type); }
+};
+
+template <typename Alloc>
+struct AllocationSize<Alloc,
+                      std::void_t<decltype(Alloc::allocationSize(size_t()))>> {
+    static size_t of(size_t n) { return Alloc::allocationSize(n); }
+};
+
+} // namespace fibhash
+
+#endif // FIBHASH_ALLOCATOR_HPP
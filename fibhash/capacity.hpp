@@ -0,0 +1,90 @@
+#ifndef FIBHASH_CAPACITY_HPP
+#define FIBHASH_CAPACITY_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace fibhash {
+
+// Check if a number is prime
+inline bool isPrime(size_t n) {
+    if (n < 2) return false;
+    for (size_t i = 2; i * i <= n; ++i) {
+        if (n % i == 0) return false;
+    }
+    return true;
+}
+
+// Return the next prime number >= n
+inline size_t nextPrime(size_t n) {
+    while (!isPrime(n)) ++n;
+    return n;
+}
+
+// Capacity policy for power-of-two sized tables. Multiplicative hashes keep
+// their top log2(capacity) bits via a shift and probes wrap with a mask, so
+// no operation on the table needs an integer division.
+struct PowerOfTwoCapacity {
+    static constexpr const char* name = "Pow2";
+
+    // Smallest power of two >= n (at least 2 so the shifts stay in range)
+    static size_t roundUp(size_t n) {
+        size_t capacity = 2;
+        while (capacity < n) capacity <<= 1;
+        return capacity;
+    }
+
+    // Capacity to grow to once the load factor limit is exceeded
+    static size_t grow(size_t capacity) { return capacity * 2; }
+
+    void resize(size_t capacity) {
+        mask = capacity - 1;
+        bits = 0;
+        while ((size_t(1) << bits) < capacity) ++bits;
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+    // Slot from the high bits of a 32-bit multiplicative hash
+    size_t fromHigh32(uint32_t h) const { return h >> (32 - bits); }
+
+    // Slot from the high bits of a 64-bit multiplicative hash
+    size_t fromHigh64(uint64_t h) const { return h >> (64 - bits); }
+
+    // Slot from the low bits of an arbitrary hash
+    size_t fromLow(size_t h) const { return h & mask; }
+
+    // Next slot in the probe sequence
+    size_t next(size_t idx) const { return (idx + 1) & mask; }
+
+    size_t mask = 0;
+    unsigned bits = 0;
+};
+
+// Capacity policy for prime sized tables. Every slot is selected with a
+// modulo, which keeps weak hashes usable at the cost of a division per probe.
+struct PrimeCapacity {
+    static constexpr const char* name = "Prime";
+
+    static size_t roundUp(size_t n) { return nextPrime(n < 2 ? 2 : n); }
+
+    static size_t grow(size_t capacity) { return nextPrime(capacity * 2); }
+
+    void resize(size_t capacity) { size = capacity; }
+
+    size_t capacity() const { return size; }
+
+    size_t fromHigh32(uint32_t h) const { return h % size; }
+
+    size_t fromHigh64(uint64_t h) const { return h % size; }
+
+    size_t fromLow(size_t h) const { return h % size; }
+
+    size_t next(size_t idx) const { return (idx + 1) % size; }
+
+    size_t size = 0;
+};
+
+} // namespace fibhash
+
+#endif // FIBHASH_CAPACITY_HPP
@@ -0,0 +1,419 @@
+#ifndef FIBHASH_CONCURRENT_HASH_TABLE_HPP
+#define FIBHASH_CONCURRENT_HASH_TABLE_HPP
+
+#include "capacity.hpp"
+#include "hash.hpp"
+#include "hash_table.hpp"
+#include "platform.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+namespace fibhash {
+
+// Fibonacci hash for keys already routed to a shard by the top shardBits of
+// the same product. Those bits are equal for every key of a shard, so slots
+// come from the bits right below them.
+struct ShardFibonacciHash {
+    static constexpr const char* name = "Fibonacci";
+
+    template <typename Capacity>
+    size_t operator()(int key, const Capacity& cap) const {
+        const uint32_t fib = 2654435769u; // 2^32 / golden ratio
+        return cap.fromHigh32((static_cast<uint32_t>(key) * fib) << shardBits);
+    }
+
+    unsigned shardBits = 0;
+};
+
+// Thread-safe set made of independently locked HashTable shards. A key's
+// shard is picked by the top bits of its Fibonacci hash, which are well
+// mixed, so shards fill evenly and each one grows on its own.
+template <typename Capacity = PowerOfTwoCapacity>
+class ConcurrentHashTable {
+public:
+    static constexpr const char* name = "Sharded";
+
+    // capacity is the initial total, spread over shardCount shards; the
+    // shard count is rounded up to a power of two
+    explicit ConcurrentHashTable(size_t capacity, size_t shardCount = 64) {
+        shardBits = 0;
+        while ((size_t(1) << shardBits) < shardCount) ++shardBits;
+        ShardFibonacciHash hash;
+        hash.shardBits = shardBits;
+        size_t count = size_t(1) << shardBits;
+        shards.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+            shards.emplace_back(std::make_unique<Shard>(capacity / count, hash));
+    }
+
+    void insert(int key) {
+        Shard& s = shardFor(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.table.insert(key);
+    }
+
+    bool contains(int key) const {
+        Shard& s = shardFor(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        return s.table.contains(key);
+    }
+
+    bool remove(int key) {
+        Shard& s = shardFor(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        return s.table.remove(key);
+    }
+
+    // Number of keys; only a snapshot while other threads are writing
+    size_t size() const {
+        size_t total = 0;
+        for (const auto& s : shards) {
+            std::lock_guard<std::mutex> lock(s->mutex);
+            total += s->table.size();
+        }
+        return total;
+    }
+
+    // Bytes allocated for all shard slot arrays
+    size_t memoryUsage() const {
+        size_t total = 0;
+        for (const auto& s : shards) {
+            std::lock_guard<std::mutex> lock(s->mutex);
+            total += s->table.memoryUsage();
+        }
+        return total;
+    }
+
+    size_t shardCount() const { return shards.size(); }
+
+private:
+    using Table = HashTable<ShardFibonacciHash, Capacity>;
+
+    // Each shard sits on its own cache lines so locks do not false-share
+    struct alignas(cacheLineSize) Shard {
+        Shard(size_t capacity, ShardFibonacciHash hash) : table(capacity, hash) {}
+
+        mutable std::mutex mutex;
+        Table table;
+    };
+
+    Shard& shardFor(int key) const {
+        const uint32_t fib = 2654435769u;
+        if (shardBits == 0) return *shards[0];
+        return *shards[(static_cast<uint32_t>(key) * fib) >> (32 - shardBits)];
+    }
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    unsigned shardBits;
+};
+
+// Read-side critical sections for the lock-free tables, so that arrays
+// unlinked by a writer can be freed. Every reading thread owns one record on
+// its own cache line, and only that thread writes it: the sequence number
+// is odd while the thread is inside a lookup. synchronize() waits until
+// every record that was odd has moved on, after which no lookup still
+// holds an array unlinked before the call. Records are shared by all
+// tables and reused once their thread exits.
+class ReadEpochs {
+public:
+    struct alignas(cacheLineSize) Record {
+        std::atomic<uint64_t> seq{0};
+        bool inUse = false; // guarded by the registry mutex
+    };
+
+    // Record of the calling thread
+    static Record& local() {
+        thread_local Record* record = nullptr;
+        if (!record) record = acquire();
+        return *record;
+    }
+
+    // The fence orders the odd sequence before the loads of the lookup,
+    // pairing with the barrier in synchronize(). Where the kernel can fence
+    // every running thread on the writer's behalf, the reader only has to
+    // stop the compiler from reordering, which keeps its misses overlapped.
+    static void enter(Record& r) {
+        r.seq.store(r.seq.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_relaxed);
+        if (heavyBarrier())
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+        else
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    static void exit(Record& r) {
+        r.seq.store(r.seq.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_release);
+    }
+
+    // Wait until every lookup that might have seen an array unlinked before
+    // the call has finished. Lookups are bounded, so this does not starve.
+    static void synchronize() {
+        if (heavyBarrier()) {
+#if defined(FIBHASH_HAVE_MEMBARRIER)
+            ::syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0);
+#endif
+        } else {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        for (const Record& r : reg.records) {
+            uint64_t seq = r.seq.load(std::memory_order_acquire);
+            if (seq % 2 == 0) continue;
+            while (r.seq.load(std::memory_order_acquire) == seq)
+                std::this_thread::yield();
+        }
+    }
+
+private:
+    struct Registry {
+        std::mutex mutex;
+        std::deque<Record> records; // stable addresses
+    };
+
+    // Whether synchronize() can fence the readers through membarrier; the
+    // process registers for it once
+    static bool heavyBarrier() {
+#if defined(FIBHASH_HAVE_MEMBARRIER)
+        static const bool registered =
+            ::syscall(SYS_membarrier,
+                      MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0) == 0;
+        return registered;
+#else
+        return false;
+#endif
+    }
+
+    // Never destroyed, so threads outliving static destruction can still
+    // release their records
+    static Registry& registry() {
+        static Registry* reg = new Registry;
+        return *reg;
+    }
+
+    // Hands a free record to its thread and takes it back at thread exit
+    struct Handle {
+        Handle() {
+            Registry& reg = registry();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+            for (Record& r : reg.records)
+                if (!r.inUse) {
+                    record = &r;
+                    break;
+                }
+            if (!record) record = &reg.records.emplace_back();
+            record->inUse = true;
+        }
+
+        ~Handle() {
+            std::lock_guard<std::mutex> lock(registry().mutex);
+            record->inUse = false;
+        }
+
+        Record* record = nullptr;
+    };
+
+    static Record* acquire() {
+        thread_local Handle handle;
+        return handle.record;
+    }
+};
+
+// Concurrent set with wait-free lookups for read-mostly workloads. It uses
+// the same Fibonacci hash and linear probing as HashTable, with every slot a
+// single atomic word holding the key and its state, so contains() is a
+// plain sequence of atomic loads. The only stores it makes go to the
+// calling thread's own ReadEpochs record.
+//
+// Writers claim empty slots with a CAS. A slot, once claimed, belongs to its
+// key forever: removal flips it to a tombstone and reinsertion flips it
+// back, so two threads inserting the same key always meet on the same slot.
+// Writers hold a shared lock that only a resize takes exclusively; during a
+// resize the old array stays valid for readers. Once the new array is
+// published the resize waits for the lookups still on the old one and
+// frees it, so only the live array stays allocated.
+template <typename Capacity = PowerOfTwoCapacity>
+class LockFreeReadHashTable {
+public:
+    static constexpr const char* name = "LockFreeRead";
+
+    explicit LockFreeReadHashTable(size_t capacity) {
+        owned = std::make_unique<Array>(Capacity::roundUp(capacity));
+        current.store(owned.get(), std::memory_order_release);
+    }
+
+    // A key that found no free slot is inserted again after the resize
+    void insert(int key) {
+        for (;;) {
+            bool placed;
+            bool grow;
+            {
+                std::shared_lock<std::shared_mutex> lock(resizeMutex);
+                Array& a = *current.load(std::memory_order_acquire);
+                grow = insertInto(a, key, placed);
+            }
+            if (grow) resize();
+            if (placed) return;
+        }
+    }
+
+    // Wait-free: bounded by one pass over the array, no locks, and no
+    // stores but the thread's own read record
+    bool contains(int key) const {
+        ReadEpochs::Record& record = ReadEpochs::local();
+        ReadEpochs::enter(record);
+        bool found = probe(*current.load(std::memory_order_acquire), key);
+        ReadEpochs::exit(record);
+        return found;
+    }
+
+    bool remove(int key) {
+        std::shared_lock<std::shared_mutex> lock(resizeMutex);
+        Array& a = *current.load(std::memory_order_acquire);
+        size_t idx = home(a, key);
+        for (size_t n = 0; n < a.capacity; ++n) {
+            uint64_t word = a.slots[idx].load(std::memory_order_acquire);
+            if (word == emptyWord) return false;
+            if (keyOf(word) == key) {
+                while (stateOf(word) == filled) {
+                    if (a.slots[idx].compare_exchange_weak(
+                            word, pack(key, deleted),
+                            std::memory_order_acq_rel)) {
+                        sz.fetch_sub(1, std::memory_order_relaxed);
+                        return true;
+                    }
+                }
+                return false;
+            }
+            idx = a.cap.next(idx);
+        }
+        return false;
+    }
+
+    // Number of keys; only a snapshot while writers are active
+    size_t size() const { return sz.load(std::memory_order_relaxed); }
+
+    // Bytes allocated for the live array
+    size_t memoryUsage() const {
+        std::shared_lock<std::shared_mutex> lock(resizeMutex);
+        return owned->capacity * sizeof(std::atomic<uint64_t>);
+    }
+
+private:
+    // A slot word is the state in the high half and the key in the low half
+    enum : uint64_t { empty = 0, filled = 1, deleted = 2 };
+    static constexpr uint64_t emptyWord = 0;
+
+    static uint64_t pack(int key, uint64_t state) {
+        return (state << 32) | static_cast<uint32_t>(key);
+    }
+    static int keyOf(uint64_t word) {
+        return static_cast<int>(static_cast<uint32_t>(word));
+    }
+    static uint64_t stateOf(uint64_t word) { return word >> 32; }
+
+    struct Array {
+        explicit Array(size_t n) : capacity(n), slots(new std::atomic<uint64_t>[n]) {
+            for (size_t i = 0; i < n; ++i)
+                slots[i].store(emptyWord, std::memory_order_relaxed);
+            cap.resize(n);
+        }
+
+        size_t capacity;
+        Capacity cap;
+        std::unique_ptr<std::atomic<uint64_t>[]> slots;
+        std::atomic<size_t> used{0}; // claimed slots, tombstones included
+    };
+
+    static size_t home(const Array& a, int key) {
+        return FibonacciHash()(key, a.cap);
+    }
+
+    static bool probe(const Array& a, int key) {
+        size_t idx = home(a, key);
+        for (size_t n = 0; n < a.capacity; ++n) {
+            uint64_t word = a.slots[idx].load(std::memory_order_acquire);
+            if (word == emptyWord) return false;
+            if (keyOf(word) == key) return stateOf(word) == filled;
+            idx = a.cap.next(idx);
+        }
+        return false;
+    }
+
+    // Returns true if the array went over the load factor limit. placed is
+    // false only if no free slot was left, and the key must be inserted
+    // again once a resize made room.
+    bool insertInto(Array& a, int key, bool& placed) {
+        placed = true;
+        size_t idx = home(a, key);
+        for (size_t n = 0; n < a.capacity; ++n) {
+            uint64_t word = a.slots[idx].load(std::memory_order_acquire);
+            if (word == emptyWord) {
+                if (a.slots[idx].compare_exchange_strong(
+                        word, pack(key, filled), std::memory_order_acq_rel)) {
+                    sz.fetch_add(1, std::memory_order_relaxed);
+                    size_t used = a.used.fetch_add(1) + 1;
+                    return used * 10 > a.capacity * 7;
+                }
+                // lost the race; word now holds the winner, check it below
+            }
+            if (keyOf(word) == key) {
+                while (stateOf(word) == deleted) {
+                    if (a.slots[idx].compare_exchange_weak(
+                            word, pack(key, filled),
+                            std::memory_order_acq_rel)) {
+                        sz.fetch_add(1, std::memory_order_relaxed);
+                        return false;
+                    }
+                }
+                return false; // already in table
+            }
+            idx = a.cap.next(idx);
+        }
+        placed = false;
+        return true; // no free slot left, a resize makes room
+    }
+
+    // Copy the live keys into a new array and publish it. Writers are
+    // excluded, so the copy sees a stable array; readers keep using it
+    // until they finish, and then it is freed.
+    void resize() {
+        std::unique_lock<std::shared_mutex> lock(resizeMutex);
+        Array& old = *current.load(std::memory_order_relaxed);
+        if (old.used.load() * 10 <= old.capacity * 7) return; // done already
+        size_t live = sz.load(std::memory_order_relaxed);
+        size_t capacity = old.capacity;
+        if (live * 10 > capacity * 7 / 2) capacity = Capacity::grow(capacity);
+        auto next = std::make_unique<Array>(capacity);
+        for (size_t i = 0; i < old.capacity; ++i) {
+            uint64_t word = old.slots[i].load(std::memory_order_relaxed);
+            if (stateOf(word) != filled) continue;
+            size_t idx = home(*next, keyOf(word));
+            while (next->slots[idx].load(std::memory_order_relaxed) != emptyWord)
+                idx = next->cap.next(idx);
+            next->slots[idx].store(word, std::memory_order_relaxed);
+            next->used.fetch_add(1, std::memory_order_relaxed);
+        }
+        current.store(next.get(), std::memory_order_seq_cst);
+        std::unique_ptr<Array> retired = std::move(owned);
+        owned = std::move(next);
+        ReadEpochs::synchronize();
+    }
+
+    std::atomic<Array*> current;
+    std::unique_ptr<Array> owned; // the array current points to
+    std::atomic<size_t> sz{0};
+    mutable std::shared_mutex resizeMutex;
+};
+
+} // namespace fibhash
+
+#endif // FIBHASH_CONCURRENT_HASH_TABLE_HPP
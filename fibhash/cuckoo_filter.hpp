@@ -0,0 +1,198 @@
+#ifndef FIBHASH_CUCKOO_FILTER_HPP
+#define FIBHASH_CUCKOO_FILTER_HPP
+
+#include "allocator.hpp"
+#include "capacity.hpp"
+#include "hash.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace fibhash {
+
+// Cuckoo filter for approximate membership tests. Each key is reduced to an
+// 8 or 16-bit Fingerprint kept in one of two buckets of bucketSize entries,
+// so a key costs a few bits instead of the 8 bytes of a HashTable slot.
+// contains never misses an inserted key but reports roughly
+// 2 * bucketSize / 2^bits of absent keys as present, so the filter is meant
+// to sit in front of an exact table and skip lookups that would fail.
+//
+// The primary bucket is taken from the high bits of the key's 64-bit
+// Fibonacci product and the fingerprint from a remix of that product. The
+// alternate bucket is the primary one xor the Fibonacci hash of the
+// fingerprint, so either bucket can be found from the other, which is what
+// lets inserts evict entries without knowing their keys. The filter does not
+// grow; size it for the expected number of keys. Every insert stores one
+// copy, so remove only keys that were inserted, once per insert.
+template <typename Fingerprint = uint16_t>
+class CuckooFilter {
+    static_assert(std::is_unsigned<Fingerprint>::value &&
+                      sizeof(Fingerprint) <= 2,
+                  "fingerprints are 8 or 16 bits");
+
+public:
+    using hasher = FibonacciHash;
+    using capacity_type = PowerOfTwoCapacity;
+    static constexpr const char* name =
+        sizeof(Fingerprint) == 1 ? "Cuckoo8" : "Cuckoo16";
+    static constexpr const char* erase_name = "InPlace";
+    static constexpr const char* allocator_name =
+        CacheAlignedAllocator<Fingerprint>::name;
+    static constexpr size_t bucketSize = 4;
+    static constexpr unsigned fingerprintBits = 8 * sizeof(Fingerprint);
+
+    // Size the filter for up to capacity keys at a 95% load factor
+    explicit CuckooFilter(size_t capacity) : sz(0) {
+        size_t buckets = PowerOfTwoCapacity::roundUp(
+            (capacity * 20 + 19 * bucketSize - 1) / (19 * bucketSize));
+        fingerprints.resize(buckets * bucketSize);
+        cap.resize(buckets);
+    }
+
+    // Add a key. Returns false, leaving the filter unchanged, once it is too
+    // full to place more keys.
+    bool insert(int key) {
+        if (victim.used) return false;
+        uint64_t h = mix(key);
+        place(cap.fromHigh64(h), fingerprintOf(h));
+        ++sz;
+        return true;
+    }
+
+    bool contains(int key) const {
+        uint64_t h = mix(key);
+        Fingerprint fp = fingerprintOf(h);
+        size_t first = cap.fromHigh64(h);
+        size_t second = alternate(first, fp);
+        if (victim.used && victim.fp == fp &&
+            (victim.bucket == first || victim.bucket == second))
+            return true;
+        return bucketHas(first, fp) || bucketHas(second, fp);
+    }
+
+    // Remove one copy of an inserted key
+    bool remove(int key) {
+        uint64_t h = mix(key);
+        Fingerprint fp = fingerprintOf(h);
+        size_t first = cap.fromHigh64(h);
+        size_t second = alternate(first, fp);
+        if (victim.used && victim.fp == fp &&
+            (victim.bucket == first || victim.bucket == second)) {
+            victim.used = false;
+            --sz;
+            return true;
+        }
+        if (!bucketErase(first, fp) && !bucketErase(second, fp)) return false;
+        --sz;
+        // The freed entry may make room for the key that did not fit
+        if (victim.used) {
+            victim.used = false;
+            place(victim.bucket, victim.fp);
+        }
+        return true;
+    }
+
+    double loadFactor() const {
+        return static_cast<double>(sz) / fingerprints.size();
+    }
+
+    size_t size() const { return sz; }
+
+    // Number of fingerprint entries
+    size_t capacity() const { return fingerprints.size(); }
+
+    size_t memoryUsage() const {
+        return CacheAlignedAllocator<Fingerprint>::allocationSize(
+            fingerprints.capacity());
+    }
+
+    double bitsPerKey() const {
+        return sz ? memoryUsage() * 8.0 / sz : 0.0;
+    }
+
+private:
+    // Kicks before an insert gives up and parks the fingerprint as victim
+    static constexpr int maxKicks = 500;
+
+    static uint64_t mix(int key) {
+        const uint64_t fib = 11400714819323198485ull;
+        return static_cast<uint64_t>(static_cast<uint32_t>(key)) * fib;
+    }
+
+    // Top bits of a second multiply of the product, so the fingerprint does
+    // not depend on how many bits the bucket index took. 0 marks an empty
+    // entry and is never used.
+    Fingerprint fingerprintOf(uint64_t h) const {
+        const uint64_t mixer = 0xC2B2AE3D27D4EB4Full;
+        Fingerprint fp =
+            static_cast<Fingerprint>(((h ^ (h >> 29)) * mixer) >> (64 - fingerprintBits));
+        return fp ? fp : 1;
+    }
+
+    size_t alternate(size_t bucket, Fingerprint fp) const {
+        const uint64_t fib = 11400714819323198485ull;
+        return bucket ^ cap.fromHigh64(static_cast<uint64_t>(fp) * fib);
+    }
+
+    bool bucketHas(size_t bucket, Fingerprint fp) const {
+        const Fingerprint* entries = &fingerprints[bucket * bucketSize];
+        bool found = false;
+        for (size_t i = 0; i < bucketSize; ++i) found |= entries[i] == fp;
+        return found;
+    }
+
+    bool bucketErase(size_t bucket, Fingerprint fp) {
+        Fingerprint* entries = &fingerprints[bucket * bucketSize];
+        for (size_t i = 0; i < bucketSize; ++i) {
+            if (entries[i] == fp) {
+                entries[i] = 0;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool bucketPut(size_t bucket, Fingerprint fp) {
+        Fingerprint* entries = &fingerprints[bucket * bucketSize];
+        for (size_t i = 0; i < bucketSize; ++i) {
+            if (entries[i] == 0) {
+                entries[i] = fp;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Store fp in bucket or its alternate, evicting random entries to their
+    // own alternates while both are full. The fingerprint still homeless
+    // after maxKicks becomes the victim.
+    void place(size_t bucket, Fingerprint fp) {
+        if (bucketPut(bucket, fp)) return;
+        bucket = alternate(bucket, fp);
+        for (int kick = 0; kick < maxKicks; ++kick) {
+            if (bucketPut(bucket, fp)) return;
+            rng ^= rng << 13;
+            rng ^= rng >> 7;
+            rng ^= rng << 17;
+            std::swap(fp, fingerprints[bucket * bucketSize + rng % bucketSize]);
+            bucket = alternate(bucket, fp);
+        }
+        victim = {bucket, fp, true};
+    }
+
+    struct Victim {
+        size_t bucket;
+        Fingerprint fp;
+        bool used;
+    };
+
+    std::vector<Fingerprint, CacheAlignedAllocator<Fingerprint>> fingerprints;
+    size_t sz;
+    PowerOfTwoCapacity cap;
+    Victim victim{0, 0, false};
+    uint64_t rng = 0x9E3779B97F4A7C15ull; // xorshift state for evictions
+};
+
+} // namespace fibhash
+
+#endif // FIBHASH_CUCKOO_FILTER_HPP
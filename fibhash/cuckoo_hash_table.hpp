@@ -0,0 +1,201 @@
+#ifndef FIBHASH_CUCKOO_HASH_TABLE_HPP
+#define FIBHASH_CUCKOO_HASH_TABLE_HPP
+
+#include "allocator.hpp"
+#include "capacity.hpp"
+#include "hash.hpp"
+#include "simd.hpp"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace fibhash {
+
+// Bucketized cuckoo hashing: every key lives in one of two buckets of
+// bucketSize slots, so a lookup reads at most two buckets whatever the load.
+// The first bucket comes from the Hash policy; for FibonacciHash that is the
+// top of the Fibonacci product. The second bucket comes from the bits right
+// below the top of the 64-bit Fibonacci product, so both choices derive from
+// one multiply instead of a second, unrelated hash. An insert that finds both
+// buckets full evicts keys along a random walk. The table grows when the walk
+// fails or the load passes 90%. Only power-of-two bucket counts are
+// supported.
+template <typename Hash, typename Capacity = PowerOfTwoCapacity>
+class CuckooHashTable {
+    static_assert(std::is_same<Capacity, PowerOfTwoCapacity>::value,
+                  "CuckooHashTable needs power-of-two bucket counts");
+
+public:
+    using hasher = Hash;
+    using capacity_type = Capacity;
+    static constexpr const char* name = "Cuckoo";
+    static constexpr const char* erase_name = "InPlace";
+    static constexpr size_t bucketSize = 4;
+
+    explicit CuckooHashTable(size_t capacity, Hash func = Hash())
+        : sz(0), hashFunc(func) {
+        allocate(Capacity::roundUp((capacity + bucketSize - 1) / bucketSize));
+    }
+
+    void insert(int key) {
+        if (contains(key)) return;
+        ++sz;
+        if (!place(key))
+            rehash(Capacity::grow(buckets.size()), &key);
+        else if (loadFactor() > 0.9)
+            rehash(Capacity::grow(buckets.size()));
+    }
+
+    bool contains(int key) const {
+        size_t first = primary(key);
+        if (scanKeys<bucketSize>(buckets[first].keys, counts[first], key) >= 0)
+            return true;
+        size_t second = secondary(key, first);
+        return scanKeys<bucketSize>(buckets[second].keys, counts[second],
+                                    key) >= 0;
+    }
+
+    // Remove a key if present; the bucket's last key fills the hole
+    bool remove(int key) {
+        size_t first = primary(key);
+        if (removeFrom(first, key)) return true;
+        return removeFrom(secondary(key, first), key);
+    }
+
+    double loadFactor() const {
+        return static_cast<double>(sz) / capacity();
+    }
+
+    size_t size() const { return sz; }
+    size_t capacity() const { return buckets.size() * bucketSize; }
+
+    // Mean number of keys in the non-empty buckets
+    double averageChainLength() const {
+        size_t used = 0;
+        for (uint8_t count : counts) used += count != 0;
+        return used ? static_cast<double>(sz) / used : 0.0;
+    }
+
+    // Fullest bucket
+    size_t maxChainLength() const {
+        uint8_t maxCount = 0;
+        for (uint8_t count : counts) maxCount = std::max(maxCount, count);
+        return maxCount;
+    }
+
+    // Share of keys stored in their second bucket
+    double averageDisplacement() const {
+        if (sz == 0) return 0.0;
+        size_t moved = 0;
+        for (size_t b = 0; b < buckets.size(); ++b)
+            for (size_t i = 0; i < counts[b]; ++i)
+                moved += primary(buckets[b].keys[i]) != b;
+        return static_cast<double>(moved) / sz;
+    }
+
+    // A key is at most one bucket away from its first choice
+    size_t maxDisplacement() const { return averageDisplacement() > 0 ? 1 : 0; }
+
+    size_t memoryUsage() const {
+        return BucketAllocator::allocationSize(buckets.capacity()) +
+               counts.capacity();
+    }
+
+    void clear() {
+        std::fill(counts.begin(), counts.end(), 0);
+        sz = 0;
+    }
+
+private:
+    struct Bucket {
+        int keys[bucketSize];
+    };
+
+    using BucketAllocator = CacheAlignedAllocator<Bucket>;
+
+    // Evictions before an insert gives up and grows the table
+    static constexpr int maxKicks = 500;
+
+    size_t primary(int key) const { return hashFunc(key, cap); }
+
+    // Bits below the top of the 64-bit product; a key whose two choices
+    // coincide uses the neighbouring bucket instead
+    size_t secondary(int key, size_t first) const {
+        const uint64_t fib = 11400714819323198485ull;
+        uint64_t h = static_cast<uint64_t>(static_cast<uint32_t>(key)) * fib;
+        size_t second = cap.fromHigh64(h << cap.bits);
+        return second != first ? second : first ^ 1;
+    }
+
+    bool removeFrom(size_t b, int key) {
+        int idx = scanKeys<bucketSize>(buckets[b].keys, counts[b], key);
+        if (idx < 0) return false;
+        buckets[b].keys[idx] = buckets[b].keys[--counts[b]];
+        --sz;
+        return true;
+    }
+
+    bool put(size_t b, int key) {
+        if (counts[b] == bucketSize) return false;
+        buckets[b].keys[counts[b]++] = key;
+        return true;
+    }
+
+    // Store key in one of its buckets, evicting along a random walk while
+    // both are full. On failure key holds the key left without a slot.
+    bool place(int& key) {
+        size_t b = primary(key);
+        if (put(b, key)) return true;
+        b = secondary(key, b);
+        for (int kick = 0; kick < maxKicks; ++kick) {
+            if (put(b, key)) return true;
+            rng ^= rng << 13;
+            rng ^= rng >> 7;
+            rng ^= rng << 17;
+            std::swap(key, buckets[b].keys[rng % bucketSize]);
+            size_t first = primary(key);
+            b = b == first ? secondary(key, first) : first;
+        }
+        return false;
+    }
+
+    // Counts start at zero, so a fresh bucket array needs no initialisation
+    void allocate(size_t bucketCount) {
+        std::vector<Bucket, BucketAllocator>(bucketCount).swap(buckets);
+        counts.assign(bucketCount, 0);
+        cap.resize(bucketCount);
+    }
+
+    // Rebuild with bucketCount buckets, plus homeless, the key a failed
+    // insert was left holding. If a key still cannot be placed the rebuild
+    // starts over one size up.
+    void rehash(size_t bucketCount, const int* homeless = nullptr) {
+        std::vector<int> all;
+        all.reserve(sz);
+        for (size_t b = 0; b < buckets.size(); ++b)
+            all.insert(all.end(), buckets[b].keys, buckets[b].keys + counts[b]);
+        if (homeless) all.push_back(*homeless);
+        for (;;) {
+            allocate(bucketCount);
+            bool placed = true;
+            for (size_t i = 0; i < all.size() && placed; ++i) {
+                int key = all[i];
+                placed = place(key);
+            }
+            if (placed) return;
+            bucketCount = Capacity::grow(bucketCount);
+        }
+    }
+
+    std::vector<Bucket, BucketAllocator> buckets;
+    std::vector<uint8_t> counts;
+    size_t sz;
+    Capacity cap;
+    Hash hashFunc;
+    uint64_t rng = 0x9E3779B97F4A7C15ull; // xorshift state for evictions
+};
+
+} // namespace fibhash
+
+#endif // FIBHASH_CUCKOO_HASH_TABLE_HPP
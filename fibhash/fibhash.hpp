@@ -0,0 +1,25 @@
+#ifndef FIBHASH_FIBHASH_HPP
+#define FIBHASH_FIBHASH_HPP
+
+// Every table of the library. Include a single header instead to pull in
+// only that table.
+
+#include "capacity.hpp"
+#include "hash.hpp"
+#include "allocator.hpp"
+#include "probe.hpp"
+#include "hash_table.hpp"
+#include "incremental_hash_table.hpp"
+#include "robin_hood_hash_table.hpp"
+#include "swiss_hash_table.hpp"
+#include "small_hash_table.hpp"
+#include "cuckoo_hash_table.hpp"
+#include "concurrent_hash_table.hpp"
+#include "hash_map.hpp"
+#include "string_hash_table.hpp"
+#include "cuckoo_filter.hpp"
+#include "frozen_hash_set.hpp"
+#include "numa.hpp"
+#include "replicated_hash_table.hpp"
+
+#endif // FIBHASH_FIBHASH_HPP
@@ -0,0 +1,266 @@
+#ifndef FIBHASH_FROZEN_HASH_SET_HPP
+#define FIBHASH_FROZEN_HASH_SET_HPP
+
+#include "hash_table.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace fibhash {
+
+// Average number of keys per bucket of the perfect hash. Larger buckets
+// need fewer seeds but take longer to place.
+constexpr size_t frozenKeysPerBucket = 4;
+
+// Hash of key under seed. The seed fills the upper half of a word that
+// goes through two rounds of xorshift and 64-bit Fibonacci multiply, so
+// every seed gives an unrelated hash. A single multiply is not enough here:
+// it keeps sequential keys evenly spaced, which is what an open-addressing
+// table wants but leaves the seed search with correlated slots.
+constexpr uint32_t frozenMix(int key, uint32_t seed) {
+    const uint64_t fib = 11400714819323198485ull; // 2^64 / golden ratio
+    uint64_t x = static_cast<uint64_t>(seed) << 32 | static_cast<uint32_t>(key);
+    x = (x ^ (x >> 31)) * fib;
+    x = (x ^ (x >> 29)) * fib;
+    return static_cast<uint32_t>(x >> 32);
+}
+
+// Scale a 32-bit hash to [0, n) by a multiply-shift instead of a modulo
+constexpr size_t frozenReduce(uint32_t h, size_t n) {
+    return static_cast<size_t>((static_cast<uint64_t>(h) * n) >> 32);
+}
+
+// Seed reserved for the bucket hash; the slot seeds stay below it
+constexpr uint32_t frozenBucketSeed = UINT32_MAX;
+
+// Bucket of key. Bucket sizes must vary: placement relies on the last
+// buckets being small, which evenly filled buckets of sequential keys
+// would never be.
+constexpr size_t frozenBucket(int key, size_t bucketCount) {
+    return frozenReduce(frozenMix(key, frozenBucketSeed), bucketCount);
+}
+
+// Slot of key under a bucket's seed, in [0, slotCount)
+constexpr size_t frozenSlot(int key, uint32_t seed, size_t slotCount) {
+    return frozenReduce(frozenMix(key, seed), slotCount);
+}
+
+// Hash-and-displace construction shared by FrozenHashSet and
+// StaticFrozenHashSet. The n distinct keys are grouped into bucketCount
+// buckets by frozenBucket. Buckets are placed largest first, while most
+// slots are still free, and each tries seeds 0, 1, ... until all its keys
+// land on distinct free slots. Slots no key claimed get keys[0], which can
+// never match there because keys[0] has its own slot. The containers are
+// only indexed, so std::vector and std::array both work:
+//   slots: slotCount, seeds: bucketCount, byBucket: n,
+//   bucketStart: bucketCount + 1, order: bucketCount, taken: slotCount,
+//   trial: n + 1.
+// Returns false if a bucket finds no seed below maxSeed.
+template <typename Slots, typename Seeds, typename ByBucket,
+          typename BucketStart, typename Order, typename Taken, typename Trial>
+constexpr bool placeBuckets(const int* keys, size_t n, size_t slotCount,
+                            size_t bucketCount, uint32_t maxSeed, Slots& slots,
+                            Seeds& seeds, ByBucket& byBucket,
+                            BucketStart& bucketStart, Order& order,
+                            Taken& taken, Trial& trial) {
+    if (n == 0) return true;
+
+    // Counting sort of the key indices by bucket, with order as the cursor
+    for (size_t b = 0; b <= bucketCount; ++b) bucketStart[b] = 0;
+    for (size_t i = 0; i < n; ++i)
+        ++bucketStart[frozenBucket(keys[i], bucketCount) + 1];
+    for (size_t b = 0; b < bucketCount; ++b) {
+        bucketStart[b + 1] += bucketStart[b];
+        order[b] = bucketStart[b];
+    }
+    for (size_t i = 0; i < n; ++i)
+        byBucket[order[frozenBucket(keys[i], bucketCount)]++] = i;
+
+    // Buckets by decreasing size, by a counting sort over the sizes
+    size_t maxSize = 0;
+    for (size_t b = 0; b < bucketCount; ++b)
+        maxSize = std::max(maxSize, bucketStart[b + 1] - bucketStart[b]);
+    for (size_t size = 0; size <= maxSize; ++size) trial[size] = 0;
+    for (size_t b = 0; b < bucketCount; ++b)
+        ++trial[bucketStart[b + 1] - bucketStart[b]];
+    for (size_t size = maxSize + 1, offset = 0; size-- > 0;) {
+        size_t count = trial[size];
+        trial[size] = offset;
+        offset += count;
+    }
+    for (size_t b = 0; b < bucketCount; ++b)
+        order[trial[bucketStart[b + 1] - bucketStart[b]]++] = b;
+
+    for (size_t s = 0; s < slotCount; ++s) taken[s] = false;
+    for (size_t o = 0; o < bucketCount; ++o) {
+        const size_t b = order[o];
+        const size_t first = bucketStart[b];
+        const size_t count = bucketStart[b + 1] - first;
+        seeds[b] = 0;
+        if (count == 0) continue;
+        bool placed = false;
+        for (uint32_t seed = 0; seed < maxSeed && !placed; ++seed) {
+            placed = true;
+            for (size_t j = 0; j < count && placed; ++j) {
+                size_t slot = frozenSlot(keys[byBucket[first + j]], seed, slotCount);
+                placed = !taken[slot];
+                for (size_t t = 0; t < j && placed; ++t) placed = trial[t] != slot;
+                trial[j] = slot;
+            }
+            if (placed) seeds[b] = seed;
+        }
+        if (!placed) return false;
+        for (size_t j = 0; j < count; ++j) {
+            taken[trial[j]] = true;
+            slots[trial[j]] = keys[byBucket[first + j]];
+        }
+    }
+    for (size_t s = 0; s < slotCount; ++s)
+        if (!taken[s]) slots[s] = keys[0];
+    return true;
+}
+
+// Read-only integer set with a perfect hash: every lookup reads one seed
+// and then exactly one slot, and with the default load of 1 the slot array
+// holds nothing but the keys. There are no states, tombstones or probe
+// sequences. Building searches a seed per bucket of about
+// frozenKeysPerBucket keys (see placeBuckets); should a search fail, the
+// build retries with a couple of percent more slots. Build it once from a
+// key list or an existing HashTable and share it between threads freely.
+class FrozenHashSet {
+public:
+    static constexpr const char* name = "Frozen";
+
+    FrozenHashSet() = default;
+
+    // Build from keys; duplicates are dropped. load is the share of slots
+    // that hold a key, at most 1 for a minimal perfect hash.
+    explicit FrozenHashSet(std::vector<int> keys, double load = 1.0) {
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        sz = keys.size();
+        if (sz == 0) return;
+        size_t slotCount = std::max(
+            sz, static_cast<size_t>(static_cast<double>(sz) / std::min(load, 1.0)));
+        const size_t bucketCount =
+            (sz + frozenKeysPerBucket - 1) / frozenKeysPerBucket;
+        std::vector<size_t> byBucket(sz), bucketStart(bucketCount + 1),
+            order(bucketCount), trial(sz + 1);
+        std::vector<bool> taken;
+        seeds.resize(bucketCount);
+        // The last free slots take about slotCount tries each, so allow a
+        // generous multiple of that before giving up on this size
+        const uint32_t maxSeed = static_cast<uint32_t>(
+            std::min<uint64_t>(frozenBucketSeed, std::max<uint64_t>(1 << 16, 16 * slotCount)));
+        for (;;) {
+            slots.assign(slotCount, 0);
+            taken.assign(slotCount, false);
+            if (placeBuckets(keys.data(), sz, slotCount, bucketCount, maxSeed,
+                             slots, seeds, byBucket, bucketStart, order, taken,
+                             trial))
+                break;
+            slotCount += slotCount / 64 + 1;
+        }
+    }
+
+    // Build from the keys of a table
+    template <typename Hash, typename Capacity, EraseMode Erase,
+              typename Allocator, bool InPlaceCleanup>
+    explicit FrozenHashSet(
+        const HashTable<Hash, Capacity, Erase, Allocator, InPlaceCleanup>& table,
+        double load = 1.0)
+        : FrozenHashSet(keysOf(table), load) {}
+
+    bool contains(int key) const {
+        if (sz == 0) return false;
+        uint32_t seed = seeds[frozenBucket(key, seeds.size())];
+        return slots[frozenSlot(key, seed, slots.size())] == key;
+    }
+
+    size_t size() const { return sz; }
+    size_t capacity() const { return slots.size(); }
+    double loadFactor() const {
+        return slots.empty() ? 0.0 : static_cast<double>(sz) / slots.size();
+    }
+
+    // Bytes of the slot and seed arrays
+    size_t memoryUsage() const {
+        return slots.capacity() * sizeof(int) + seeds.capacity() * sizeof(uint32_t);
+    }
+
+private:
+    template <typename Table>
+    static std::vector<int> keysOf(const Table& table) {
+        std::vector<int> keys;
+        keys.reserve(table.size());
+        table.forEach([&](int key) { keys.push_back(key); });
+        return keys;
+    }
+
+    std::vector<int> slots;
+    std::vector<uint32_t> seeds;
+    size_t sz = 0;
+};
+
+// FrozenHashSet for a key set fixed at compile time. The construction is
+// constexpr, so a constexpr instance is searched by the compiler and ends
+// up as two static arrays. Keys must be distinct; check valid(), ideally
+// in a static_assert, since a failed search cannot grow the table.
+//
+//   constexpr auto ports = makeFrozenSet({22, 80, 443, 8080});
+//   static_assert(ports.valid() && ports.contains(443));
+template <size_t N, size_t Slots = N>
+class StaticFrozenHashSet {
+    static_assert(Slots >= N, "every key needs a slot");
+
+public:
+    static constexpr size_t bucketCount =
+        N == 0 ? 1 : (N + frozenKeysPerBucket - 1) / frozenKeysPerBucket;
+
+    constexpr explicit StaticFrozenHashSet(const int (&keys)[N]) {
+        std::array<size_t, N> byBucket{};
+        std::array<size_t, bucketCount + 1> bucketStart{};
+        std::array<size_t, bucketCount> order{};
+        std::array<bool, Slots> taken{};
+        std::array<size_t, N + 1> trial{};
+        ok = placeBuckets(keys, N, Slots, bucketCount, maxSeed, slots, seeds,
+                          byBucket, bucketStart, order, taken, trial);
+    }
+
+    // Whether a seed was found for every bucket, which fails for duplicate
+    // keys. contains is meaningless otherwise.
+    constexpr bool valid() const { return ok; }
+
+    constexpr bool contains(int key) const {
+        if constexpr (N == 0) {
+            (void)key;
+            return false;
+        } else {
+            uint32_t seed = seeds[frozenBucket(key, bucketCount)];
+            return slots[frozenSlot(key, seed, Slots)] == key;
+        }
+    }
+
+    static constexpr size_t size() { return N; }
+    static constexpr size_t capacity() { return Slots; }
+
+private:
+    // Bounds the work of the compiler's search
+    static constexpr uint32_t maxSeed = 1 << 16;
+
+    std::array<int, Slots> slots{};
+    std::array<uint32_t, bucketCount> seeds{};
+    bool ok = false;
+};
+
+template <size_t N>
+constexpr StaticFrozenHashSet<N> makeFrozenSet(const int (&keys)[N]) {
+    return StaticFrozenHashSet<N>(keys);
+}
+
+} // namespace fibhash
+
+#endif // FIBHASH_FROZEN_HASH_SET_HPP
@@ -0,0 +1,53 @@
+#ifndef FIBHASH_HASH_HPP
+#define FIBHASH_HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace fibhash {
+
+// Fibonacci hashing for integers: the multiplication mixes every key bit
+// into the high bits of the product, which the capacity policy then keeps.
+// Hash policies are stateless functors so they inline into the probe loop.
+struct FibonacciHash {
+    static constexpr const char* name = "Fibonacci";
+
+    template <typename Capacity>
+    size_t operator()(int key, const Capacity& cap) const {
+        const uint32_t fib = 2654435769u; // 2^32 / golden ratio
+        return cap.fromHigh32(static_cast<uint32_t>(key) * fib);
+    }
+
+    // 64-bit keys use the 64-bit constant so no key bits are truncated
+    template <typename Capacity>
+    size_t operator()(uint64_t key, const Capacity& cap) const {
+        const uint64_t fib = 11400714819323198485ull; // 2^64 / golden ratio
+        return cap.fromHigh64(key * fib);
+    }
+
+    // Other keys are reduced with std::hash first, then mixed the same way
+    template <typename Key, typename Capacity>
+    size_t operator()(const Key& key, const Capacity& cap) const {
+        return (*this)(static_cast<uint64_t>(std::hash<Key>()(key)), cap);
+    }
+};
+
+// Simple modulo hashing
+struct ModuloHash {
+    static constexpr const char* name = "Modulo";
+
+    template <typename Capacity>
+    size_t operator()(int key, const Capacity& cap) const {
+        return cap.fromLow(static_cast<uint32_t>(key));
+    }
+
+    template <typename Key, typename Capacity>
+    size_t operator()(const Key& key, const Capacity& cap) const {
+        return cap.fromLow(std::hash<Key>()(key));
+    }
+};
+
+} // namespace fibhash
+
+#endif // FIBHASH_HASH_HPP
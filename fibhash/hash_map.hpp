@@ -0,0 +1,259 @@
+#ifndef FIBHASH_HASH_MAP_HPP
+#define FIBHASH_HASH_MAP_HPP
+
+#include "capacity.hpp"
+#include "hash.hpp"
+#include "probe.hpp"
+
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace fibhash {
+
+// Open addressing hash map with the same linear probing scheme as HashTable,
+// sharing its probe core from probe.hpp. Entries are constructed in place
+// inside the slot array, so emplacing a heavy value never builds a
+// temporary that has to be copied in.
+template <typename K, typename V, typename Hash = FibonacciHash,
+          typename Capacity = PowerOfTwoCapacity>
+class HashMap {
+public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<K, V>;
+    using hasher = Hash;
+
+    explicit HashMap(size_t capacity = 16, Hash func = Hash())
+        : sz(0), deleted(0), hashFunc(func) {
+        allocate(Capacity::roundUp(capacity));
+    }
+
+    // Entries keep their slots and tombstones are copied as they are, so
+    // every probe sequence stays intact
+    HashMap(const HashMap& other)
+        : sz(0), deleted(other.deleted), hashFunc(other.hashFunc) {
+        allocate(other.states.size());
+        for (size_t i = 0; i < other.states.size(); ++i) {
+            if (other.states[i] == State::Filled) {
+                new (&slots[i]) value_type(other.slot(i));
+                ++sz;
+            }
+            states[i] = other.states[i];
+        }
+    }
+
+    HashMap(HashMap&& other) noexcept
+        : states(std::move(other.states)), slots(std::move(other.slots)),
+          sz(other.sz), deleted(other.deleted), cap(other.cap),
+          hashFunc(other.hashFunc) {
+        other.sz = 0;
+        other.deleted = 0;
+    }
+
+    HashMap& operator=(HashMap other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    ~HashMap() { clear(); }
+
+    void swap(HashMap& other) noexcept {
+        std::swap(states, other.states);
+        std::swap(slots, other.slots);
+        std::swap(sz, other.sz);
+        std::swap(deleted, other.deleted);
+        std::swap(cap, other.cap);
+        std::swap(hashFunc, other.hashFunc);
+    }
+
+    // Pointer to the value stored for key, or nullptr if absent
+    V* find(const K& key) {
+        size_t idx = findIndex(key);
+        return idx == npos ? nullptr : &slot(idx).second;
+    }
+
+    const V* find(const K& key) const {
+        size_t idx = findIndex(key);
+        return idx == npos ? nullptr : &slot(idx).second;
+    }
+
+    bool contains(const K& key) const { return findIndex(key) != npos; }
+
+    // Value for key, default constructing it if absent
+    V& operator[](const K& key) { return *try_emplace(key).first; }
+    V& operator[](K&& key) { return *try_emplace(std::move(key)).first; }
+
+    // Insert key with a value built from args unless key is already present.
+    // The arguments are left untouched when the key exists, and finding it
+    // never rehashes, so pointers to the values stay valid.
+    template <typename... Args>
+    std::pair<V*, bool> try_emplace(const K& key, Args&&... args) {
+        return emplaceInternal(key, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    std::pair<V*, bool> try_emplace(K&& key, Args&&... args) {
+        return emplaceInternal(std::move(key), std::forward<Args>(args)...);
+    }
+
+    // Like try_emplace, but the key is first constructed from key
+    template <typename KeyArg, typename... Args>
+    std::pair<V*, bool> emplace(KeyArg&& key, Args&&... args) {
+        return emplaceInternal(K(std::forward<KeyArg>(key)),
+                               std::forward<Args>(args)...);
+    }
+
+    // Remove a key if present
+    bool erase(const K& key) {
+        size_t idx = findIndex(key);
+        if (idx == npos) return false;
+        slot(idx).~value_type();
+        states[idx] = State::Deleted;
+        --sz;
+        ++deleted;
+        return true;
+    }
+
+    size_t size() const { return sz; }
+    bool empty() const { return sz == 0; }
+
+    // Current load factor
+    double loadFactor() const { return static_cast<double>(sz) / states.size(); }
+
+    // Estimated memory usage in bytes
+    size_t memoryUsage() const {
+        return states.size() * (sizeof(value_type) + sizeof(State));
+    }
+
+    // Destroy every entry, keeping the capacity
+    void clear() {
+        for (size_t i = 0; i < states.size(); ++i) {
+            if (states[i] == State::Filled) slot(i).~value_type();
+            states[i] = State::Empty;
+        }
+        sz = 0;
+        deleted = 0;
+    }
+
+    // Visit every entry as fn(key, value)
+    template <typename Fn>
+    void forEach(Fn fn) const {
+        for (size_t i = 0; i < states.size(); ++i)
+            if (states[i] == State::Filled) fn(slot(i).first, slot(i).second);
+    }
+
+private:
+    using State = SlotState;
+
+    struct Storage {
+        alignas(value_type) unsigned char bytes[sizeof(value_type)];
+    };
+
+    static constexpr size_t npos = probeNotFound;
+
+    value_type& slot(size_t i) {
+        return *std::launder(reinterpret_cast<value_type*>(&slots[i]));
+    }
+
+    const value_type& slot(size_t i) const {
+        return *std::launder(reinterpret_cast<const value_type*>(&slots[i]));
+    }
+
+    void allocate(size_t capacity) {
+        states.assign(capacity, State::Empty);
+        slots.reset(new Storage[capacity]);
+        cap.resize(capacity);
+    }
+
+    size_t findIndex(const K& key) const {
+        size_t probes = 0;
+        size_t tombstones = 0;
+        return probeFind(
+            cap, hashFunc(key, cap), [&](size_t i) { return states[i]; },
+            [&](size_t i) { return slot(i).first == key; }, probes, tombstones);
+    }
+
+    InsertProbe probeFor(const K& key) const {
+        size_t probes = 0;
+        size_t tombstones = 0;
+        return probeInsert(
+            cap, hashFunc(key, cap), [&](size_t i) { return states[i]; },
+            [&](size_t i) { return slot(i).first == key; }, probes, tombstones);
+    }
+
+    // Probe first and only grow for a key that is really new. When the
+    // entries have to be rehashed, the new entry is constructed in the new
+    // array before the old entries move, so args may still refer to them.
+    // Once keys and tombstones together would fill maxOccupied of the
+    // slots, the entries are rehashed at the same capacity instead.
+    template <typename KeyArg, typename... Args>
+    std::pair<V*, bool> emplaceInternal(KeyArg&& key, Args&&... args) {
+        InsertProbe at = probeFor(key);
+        if (at.found) return {&slot(at.index).second, false};
+        size_t idx = at.index;
+        bool grow = static_cast<double>(sz + 1) / states.size() > 0.7;
+        bool crowded = static_cast<double>(sz + deleted + !at.reusesTombstone) >
+                       maxOccupied * states.size();
+        if (!grow && !crowded) {
+            construct(idx, std::forward<KeyArg>(key), std::forward<Args>(args)...);
+            if (at.reusesTombstone) --deleted;
+            return {&slot(idx).second, true};
+        }
+
+        std::vector<State> oldStates = std::move(states);
+        std::unique_ptr<Storage[]> oldSlots = std::move(slots);
+        size_t oldCapacity = oldStates.size();
+        allocate(grow ? Capacity::grow(oldCapacity) : oldCapacity);
+        idx = hashFunc(key, cap);
+        try {
+            construct(idx, std::forward<KeyArg>(key), std::forward<Args>(args)...);
+        } catch (...) {
+            states = std::move(oldStates);
+            slots = std::move(oldSlots);
+            cap.resize(oldCapacity);
+            throw;
+        }
+        deleted = 0;
+        moveEntries(oldStates, oldSlots);
+        return {&slot(idx).second, true};
+    }
+
+    template <typename KeyArg, typename... Args>
+    void construct(size_t idx, KeyArg&& key, Args&&... args) {
+        new (&slots[idx]) value_type(
+            std::piecewise_construct,
+            std::forward_as_tuple(std::forward<KeyArg>(key)),
+            std::forward_as_tuple(std::forward<Args>(args)...));
+        states[idx] = State::Filled;
+        ++sz;
+    }
+
+    // Move the entries of an old array into the current one, which holds
+    // no tombstones, destroying them on the way
+    void moveEntries(const std::vector<State>& oldStates,
+                     std::unique_ptr<Storage[]>& oldSlots) {
+        for (size_t i = 0; i < oldStates.size(); ++i) {
+            if (oldStates[i] != State::Filled) continue;
+            value_type& entry =
+                *std::launder(reinterpret_cast<value_type*>(&oldSlots[i]));
+            size_t idx = hashFunc(entry.first, cap);
+            while (states[idx] == State::Filled) idx = cap.next(idx);
+            new (&slots[idx]) value_type(std::move(entry));
+            states[idx] = State::Filled;
+            entry.~value_type();
+        }
+    }
+
+    std::vector<State> states;
+    std::unique_ptr<Storage[]> slots;
+    size_t sz;
+    size_t deleted; // tombstones
+    Capacity cap;
+    Hash hashFunc;
+};
+
+} // namespace fibhash
+
+#endif // FIBHASH_HASH_MAP_HPP
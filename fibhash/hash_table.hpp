@@ -0,0 +1,920 @@
+#ifndef FIBHASH_HASH_TABLE_HPP
+#define FIBHASH_HASH_TABLE_HPP
+
+#include "allocator.hpp"
+#include "capacity.hpp"
+#include "hash.hpp"
+#include "platform.hpp"
+#include "probe.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace fibhash {
+
+// Header of a file written by HashTable::save. The slot array follows at
+// slotOffset, in the table's in-memory layout and native byte order.
+struct TableFileHeader {
+    char magic[8];        // "FIBHASH"
+    uint32_t version;
+    uint32_t slotSize;    // sizeof one slot, checked on open
+    uint64_t capacity;    // number of slots
+    uint64_t size;        // number of stored keys
+    uint64_t seed;        // hash seed; 0 for the stateless hash policies
+    uint64_t slotOffset;  // byte offset of the slot array
+    char hash[16];        // Hash::name
+    char capacityPolicy[16];
+    char erase[16];
+};
+
+constexpr uint32_t tableFileVersion = 1;
+
+// Offset of the slot array; a cache-line multiple so mapped slots stay
+// aligned like allocated ones
+constexpr uint64_t tableFileSlotOffset = 128;
+
+static_assert(sizeof(TableFileHeader) <= tableFileSlotOffset,
+              "header must fit before the slot array");
+
+// Probe counters of a HashTable built with FIBHASH_PROBE_STATS. A probe is
+// one slot examined, so an operation that finds its key in the home slot
+// takes one probe. Rehashing is timed but its reinsertions are not counted.
+struct ProbeStats {
+    static constexpr size_t histogramSize = 32;
+
+    struct Op {
+        uint64_t count = 0;
+        uint64_t probes = 0;
+
+        double average() const {
+            return count ? static_cast<double>(probes) / count : 0.0;
+        }
+    };
+
+    Op insert;
+    Op lookup;
+    Op erase;
+    // histogram[i] counts operations that took i + 1 probes; the last
+    // bucket also holds every longer probe sequence
+    uint64_t histogram[histogramSize] = {};
+    uint64_t tombstonesSeen = 0;
+    uint64_t rehashes = 0;
+    uint64_t rehashNs = 0;
+    uint64_t cleanups = 0; // same-capacity rebuilds that drop tombstones
+    uint64_t cleanupNs = 0;
+
+    void record(Op& op, size_t probes, size_t tombstones) {
+        ++op.count;
+        op.probes += probes;
+        ++histogram[std::min(probes, histogramSize) - 1];
+        tombstonesSeen += tombstones;
+    }
+};
+
+// How HashTable::remove frees a slot
+enum class EraseMode {
+    Tombstone,     // mark the slot Deleted and leave the cluster in place
+    BackwardShift  // pull later cluster entries back so no tombstone remains
+};
+
+constexpr const char* eraseModeName(EraseMode mode) {
+    return mode == EraseMode::Tombstone ? "Tombstone" : "BackwardShift";
+}
+
+// Simple open addressing hash table for integer keys using linear probing.
+// The Hash policy maps keys to slots and the Capacity policy decides how
+// tables grow and how hashes are reduced to a slot index. Allocator is
+// rebound to the internal slot type, so any standard allocator works,
+// including std::pmr::polymorphic_allocator for arena-backed tables.
+//
+// With FIBHASH_PROBE_STATS the table also keeps ProbeStats. Lookups then
+// write to the table, so const calls from several threads need a lock.
+//
+// InPlaceCleanup lets insert() rebuild a table crowded with tombstones.
+// Owners that must not stall on that O(n) rebuild turn it off and check
+// needsCleanup() themselves.
+template <typename Hash, typename Capacity = PowerOfTwoCapacity,
+          EraseMode Erase = EraseMode::Tombstone,
+          typename Allocator = CacheAlignedAllocator<int>,
+          bool InPlaceCleanup = true>
+class HashTable {
+    using State = SlotState;
+
+    // Key and state side by side, so a probe touches a single cache line
+    struct Slot {
+        int key;
+        State state;
+    };
+
+public:
+    using hasher = Hash;
+    using capacity_type = Capacity;
+    static constexpr const char* name = "Linear";
+    static constexpr const char* erase_name = eraseModeName(Erase);
+    using allocator_type = Allocator;
+    static constexpr const char* allocator_name =
+        AllocatorName<Allocator>::value;
+    static constexpr bool probe_stats = FIBHASH_PROBE_STATS;
+
+    // Construct table with given capacity, hashing function and allocator
+    explicit HashTable(size_t capacity, Hash func = Hash(),
+                       const Allocator& alloc = Allocator())
+        : slots(SlotAllocator(alloc)), sz(0), deleted(0), cleanupCount(0),
+          hashFunc(func) {
+        allocate(Capacity::roundUp(capacity));
+    }
+
+    HashTable(const HashTable&) = default;
+    HashTable(HashTable&&) noexcept = default;
+    HashTable& operator=(const HashTable&) = default;
+    HashTable& operator=(HashTable&&) noexcept = default;
+
+    // Insert a key using linear probing with automatic resizing. Tombstones
+    // lengthen probes like keys do, so once keys and tombstones together
+    // fill maxOccupied of the slots the table is rebuilt in place at the
+    // same capacity.
+    void insert(int key) {
+        insertInternal(key, hashFunc(key, cap));
+        if (loadFactor() > 0.7) {
+            rehash(Capacity::grow(slots.size()));
+        } else if (InPlaceCleanup && needsCleanup()) {
+            dropTombstones();
+        }
+    }
+
+    // Check if key is present
+    bool contains(int key) const { return containsFrom(key, hashFunc(key, cap)); }
+
+    // Remove a key if present
+    bool remove(int key) { return removeFrom(key, hashFunc(key, cap)); }
+
+    // Look up n keys and set out[i] to 1 if keys[i] is present, else 0. Home
+    // slots are hashed and prefetched batchWindow keys ahead of the probes,
+    // so the cache misses of independent keys overlap instead of queueing.
+    void contains_batch(const int* batch, size_t n, uint8_t* out) const {
+        forBatch(batch, n, [&](int key, size_t home, size_t i) {
+            out[i] = containsFrom(key, home);
+        });
+    }
+
+    // Insert n keys. The table is grown up front, so no rehash happens in
+    // the middle of the batch and the prefetched slots stay valid.
+    void insert_batch(const int* batch, size_t n) {
+        reserve(sz + n);
+        forBatch(batch, n, [&](int key, size_t home, size_t) {
+            insertInternal(key, home);
+        });
+    }
+
+    // Insert many keys using several threads. The table is sized once, the
+    // keys are bucketed by which of `threads` contiguous slot ranges their
+    // home slot falls in (for Fibonacci hashing, by the top hash bits), and
+    // every thread inserts its bucket without synchronisation, probing only
+    // inside its own range. Keys whose probe would leave the range are
+    // inserted serially at the end.
+    void build(const std::vector<int>& input, size_t threads) {
+        reserve(sz + input.size());
+        if (threads <= 1 || input.size() < threads) {
+            for (int key : input) insertInternal(key, hashFunc(key, cap));
+            return;
+        }
+        const size_t n = input.size();
+        const size_t capacity = slots.size();
+        auto rangeOf = [&](int key) {
+            return hashFunc(key, cap) * threads / capacity;
+        };
+        auto chunk = [&](size_t t) {
+            return std::make_pair(n * t / threads, n * (t + 1) / threads);
+        };
+        auto parallel = [&](auto fn) {
+            std::vector<std::thread> workers;
+            for (size_t t = 0; t < threads; ++t) workers.emplace_back(fn, t);
+            for (auto& w : workers) w.join();
+        };
+
+        // Counting sort of the keys by range: histogram each input chunk,
+        // turn the counts into write offsets, then scatter
+        std::vector<size_t> counts(threads * threads, 0);
+        parallel([&](size_t t) {
+            auto [first, last] = chunk(t);
+            for (size_t i = first; i < last; ++i)
+                ++counts[t * threads + rangeOf(input[i])];
+        });
+        std::vector<size_t> rangeStart(threads + 1, 0);
+        size_t offset = 0;
+        for (size_t r = 0; r < threads; ++r) {
+            rangeStart[r] = offset;
+            for (size_t t = 0; t < threads; ++t) {
+                size_t c = counts[t * threads + r];
+                counts[t * threads + r] = offset;
+                offset += c;
+            }
+        }
+        rangeStart[threads] = offset;
+        std::vector<int> bucketed(n);
+        parallel([&](size_t t) {
+            auto [first, last] = chunk(t);
+            for (size_t i = first; i < last; ++i)
+                bucketed[counts[t * threads + rangeOf(input[i])]++] = input[i];
+        });
+
+        std::vector<std::vector<int>> overflow(threads);
+        std::vector<size_t> added(threads, 0);
+        std::vector<size_t> reused(threads, 0);
+        parallel([&](size_t r) {
+            size_t end = (r + 1) * capacity / threads;
+            for (size_t i = rangeStart[r]; i < rangeStart[r + 1]; ++i) {
+                int key = bucketed[i];
+                if (!insertBounded(key, hashFunc(key, cap), end, added[r],
+                                   reused[r]))
+                    overflow[r].push_back(key);
+            }
+        });
+        for (size_t r = 0; r < threads; ++r) {
+            sz += added[r];
+            deleted -= reused[r];
+        }
+        for (const auto& keys : overflow)
+            for (int key : keys) insertInternal(key, hashFunc(key, cap));
+    }
+
+    // Write the table to path as a TableFileHeader followed by the slot
+    // array, ready to be mapped back with MappedView. Returns false on I/O
+    // errors.
+    bool save(const std::string& path) const {
+        TableFileHeader header{};
+        std::strncpy(header.magic, "FIBHASH", sizeof(header.magic));
+        header.version = tableFileVersion;
+        header.slotSize = sizeof(Slot);
+        header.capacity = slots.size();
+        header.size = sz;
+        header.seed = 0;
+        header.slotOffset = tableFileSlotOffset;
+        std::strncpy(header.hash, Hash::name, sizeof(header.hash) - 1);
+        std::strncpy(header.capacityPolicy, Capacity::name,
+                     sizeof(header.capacityPolicy) - 1);
+        std::strncpy(header.erase, erase_name, sizeof(header.erase) - 1);
+
+        std::ofstream out(path, std::ios::binary);
+        if (!out) return false;
+        char padding[tableFileSlotOffset] = {};
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(padding, tableFileSlotOffset - sizeof(header));
+        out.write(reinterpret_cast<const char*>(slots.data()),
+                  static_cast<std::streamsize>(slots.size() * sizeof(Slot)));
+        return static_cast<bool>(out);
+    }
+
+    // Read-only table backed by a file written by save(). The file is mapped
+    // with mmap and lookups run directly on the mapped pages, so opening it
+    // costs no deserialisation. Without mmap the file is read into memory.
+    class MappedView {
+    public:
+        MappedView() = default;
+        MappedView(const MappedView&) = delete;
+        MappedView& operator=(const MappedView&) = delete;
+        ~MappedView() { close(); }
+
+        // Map path. Returns false if it cannot be read or was written by a
+        // table with a different hash, capacity policy or slot layout.
+        bool open(const std::string& path, Hash func = Hash()) {
+            close();
+            const unsigned char* data = nullptr;
+            size_t length = 0;
+#if defined(FIBHASH_HAVE_MMAP)
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) return false;
+            struct stat st;
+            if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+                ::close(fd);
+                return false;
+            }
+            length = static_cast<size_t>(st.st_size);
+            void* mapped = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (mapped == MAP_FAILED) return false;
+            mapping = mapped;
+            mappingSize = length;
+            data = static_cast<const unsigned char*>(mapped);
+#else
+            std::ifstream in(path, std::ios::binary);
+            if (!in) return false;
+            buffer.assign(std::istreambuf_iterator<char>(in),
+                          std::istreambuf_iterator<char>());
+            data = buffer.data();
+            length = buffer.size();
+#endif
+            if (!attach(data, length)) {
+                close();
+                return false;
+            }
+            hashFunc = func;
+            return true;
+        }
+
+        void close() {
+#if defined(FIBHASH_HAVE_MMAP)
+            if (mapping) ::munmap(mapping, mappingSize);
+            mapping = nullptr;
+            mappingSize = 0;
+#endif
+            buffer.clear();
+            slots = nullptr;
+            slotCount = 0;
+            count = 0;
+        }
+
+        bool contains(int key) const {
+            return slotCount != 0 &&
+                   probeContains(slots, cap, key, hashFunc(key, cap));
+        }
+
+        size_t size() const { return count; }
+        size_t capacity() const { return slotCount; }
+
+    private:
+        bool attach(const unsigned char* data, size_t length) {
+            TableFileHeader header;
+            if (length < sizeof(header)) return false;
+            std::memcpy(&header, data, sizeof(header));
+            if (std::strncmp(header.magic, "FIBHASH", sizeof(header.magic)) != 0 ||
+                header.version != tableFileVersion ||
+                header.slotSize != sizeof(Slot) ||
+                std::strncmp(header.hash, Hash::name, sizeof(header.hash)) != 0 ||
+                std::strncmp(header.capacityPolicy, Capacity::name,
+                             sizeof(header.capacityPolicy)) != 0 ||
+                header.capacity == 0 ||
+                Capacity::roundUp(header.capacity) != header.capacity ||
+                header.slotOffset % alignof(Slot) != 0 ||
+                header.slotOffset > length ||
+                (length - header.slotOffset) / sizeof(Slot) < header.capacity)
+                return false;
+            slots = reinterpret_cast<const Slot*>(data + header.slotOffset);
+            slotCount = header.capacity;
+            count = header.size;
+            cap.resize(slotCount);
+            return true;
+        }
+
+        const Slot* slots = nullptr;
+        size_t slotCount = 0;
+        size_t count = 0;
+        Capacity cap;
+        Hash hashFunc;
+        void* mapping = nullptr;
+        size_t mappingSize = 0;
+        std::vector<unsigned char> buffer; // used when mmap is unavailable
+    };
+
+    // Remove n keys. If out is not null, out[i] is set to 1 if keys[i] was
+    // removed, else 0.
+    void remove_batch(const int* batch, size_t n, uint8_t* out = nullptr) {
+        forBatch(batch, n, [&](int key, size_t home, size_t i) {
+            bool removed = removeFrom(key, home);
+            if (out) out[i] = removed;
+        });
+    }
+
+    // Current load factor
+    double loadFactor() const { return static_cast<double>(sz) / slots.size(); }
+
+    size_t size() const { return sz; }
+    size_t capacity() const { return slots.size(); }
+
+    // Slots holding a tombstone; always 0 with EraseMode::BackwardShift
+    size_t tombstones() const { return deleted; }
+
+    // Number of in-place rebuilds that dropped the tombstones
+    size_t cleanups() const { return cleanupCount; }
+
+    // True once keys and tombstones together fill maxOccupied of the slots
+    bool needsCleanup() const {
+        return static_cast<double>(sz + deleted) > maxOccupied * slots.size();
+    }
+
+    // Counters since construction or the last resetProbeStats(); all zero
+    // unless built with FIBHASH_PROBE_STATS
+    ProbeStats probeStats() const {
+#if FIBHASH_PROBE_STATS
+        return stats;
+#else
+        return {};
+#endif
+    }
+
+    void resetProbeStats() {
+#if FIBHASH_PROBE_STATS
+        stats = ProbeStats();
+#endif
+    }
+
+    // Call fn with every stored key, in slot order
+    template <typename Fn>
+    void forEach(Fn fn) const {
+        for (const Slot& slot : slots)
+            if (slot.state == State::Filled) fn(slot.key);
+    }
+
+    // Set algebra. Each operation walks one table's slot array front to
+    // back, skipping empty slots eight at a time, and looks the keys up in
+    // the other table in prefetched batches. Nothing rehashes mid-way:
+    // merge grows this table once for the largest possible outcome, and
+    // intersect and difference gather their keys before sizing the result
+    // exactly. With threads > 1 the walked slot array is split into that
+    // many ranges and the result is filled with build(). The lookups are
+    // not counted in the probe statistics, so they stay safe to run from
+    // several threads.
+
+    // Add every key of other
+    void merge(const HashTable& other, size_t threads = 1) {
+        if (threads > 1) {
+            build(other.collect(threads,
+                                [](const int* keys, size_t n, std::vector<int>& out) {
+                                    out.insert(out.end(), keys, keys + n);
+                                }),
+                  threads);
+            return;
+        }
+        reserve(sz + other.sz);
+        other.scanSlots(0, other.slots.size(), [&](const int* keys, size_t n) {
+            forBatch(keys, n, [&](int key, size_t home, size_t) {
+                insertInternal(key, home);
+            });
+            return true;
+        });
+    }
+
+    // Table of the keys present in both tables. The smaller table is
+    // walked and the larger one probed.
+    HashTable intersect(const HashTable& other, size_t threads = 1) const {
+        if (other.sz < sz) return other.intersect(*this, threads);
+        return selectKeys(other, true, threads);
+    }
+
+    // Table of the keys of this table that other lacks
+    HashTable difference(const HashTable& other, size_t threads = 1) const {
+        return selectKeys(other, false, threads);
+    }
+
+    // Whether every key of other is also in this table. Stops at the first
+    // missing key.
+    bool contains_all(const HashTable& other, size_t threads = 1) const {
+        if (other.sz > sz) return false;
+        std::atomic<bool> all{true};
+        forRanges(other.slots.size(), threads, [&](size_t, size_t first, size_t last) {
+            other.scanSlots(first, last, [&](const int* keys, size_t n) {
+                forBatch(keys, n, [&](int key, size_t home, size_t) {
+                    if (!probeContains(slots.data(), cap, key, home))
+                        all.store(false, std::memory_order_relaxed);
+                });
+                return all.load(std::memory_order_relaxed);
+            });
+        });
+        return all.load();
+    }
+
+    // Remove every key stored in slots [first, last) and pass it to fn. The
+    // slots become tombstones whatever the erase mode, so this is meant for
+    // tables that are being emptied for good.
+    template <typename Fn>
+    void drainSlots(size_t first, size_t last, Fn fn) {
+        for (size_t i = first; i < last; ++i) {
+            if (slots[i].state != State::Filled) continue;
+            slots[i].state = State::Deleted;
+            --sz;
+            ++deleted;
+            fn(slots[i].key);
+        }
+    }
+
+    // Return the memory behind slots [first, last) to the system, so a
+    // retired table can be released piecewise before it is destroyed. The
+    // slots read as empty afterwards; never look the table up again.
+    void releaseSlots(size_t first, size_t last) {
+        releasePages(slots.data() + first, (last - first) * sizeof(Slot));
+    }
+
+    // Average cluster length (contiguous filled slots)
+    double averageChainLength() const {
+        size_t clusterCount = 0;
+        size_t total = 0;
+        for (size_t i = 0; i < slots.size();) {
+            if (slots[i].state == State::Filled) {
+                size_t len = 0;
+                while (i < slots.size() && slots[i].state == State::Filled) {
+                    ++len;
+                    ++i;
+                }
+                ++clusterCount;
+                total += len;
+            } else {
+                ++i;
+            }
+        }
+        if (clusterCount == 0) return 0.0;
+        return static_cast<double>(total) / clusterCount;
+    }
+
+    // Maximum cluster length
+    size_t maxChainLength() const {
+        size_t maxLen = 0;
+        for (size_t i = 0; i < slots.size();) {
+            if (slots[i].state == State::Filled) {
+                size_t len = 0;
+                while (i < slots.size() && slots[i].state == State::Filled) {
+                    ++len;
+                    ++i;
+                }
+                if (len > maxLen) maxLen = len;
+            } else {
+                ++i;
+            }
+        }
+        return maxLen;
+    }
+
+    // Mean distance of stored keys from their home slot
+    double averageDisplacement() const {
+        if (sz == 0) return 0.0;
+        size_t total = 0;
+        for (size_t i = 0; i < slots.size(); ++i)
+            if (slots[i].state == State::Filled) total += displacement(i);
+        return static_cast<double>(total) / sz;
+    }
+
+    // Largest distance of a stored key from its home slot
+    size_t maxDisplacement() const {
+        size_t maxDist = 0;
+        for (size_t i = 0; i < slots.size(); ++i)
+            if (slots[i].state == State::Filled && displacement(i) > maxDist)
+                maxDist = displacement(i);
+        return maxDist;
+    }
+
+    // Bytes allocated for the slot array, allocator padding included
+    size_t memoryUsage() const {
+        return AllocationSize<SlotAllocator>::of(slots.capacity());
+    }
+
+    allocator_type get_allocator() const {
+        return allocator_type(slots.get_allocator());
+    }
+
+    // Clear the table
+    void clear() {
+        for (Slot& slot : slots) slot.state = State::Empty;
+        sz = 0;
+        deleted = 0;
+    }
+
+    // Grow once so that n keys fit without any rehash on the way
+    void reserve(size_t n) {
+        size_t needed = Capacity::roundUp(capacityFor(n));
+        if (needed > slots.size()) rehash(needed);
+    }
+
+    // Shrink to the smallest capacity that holds the current keys. This also
+    // drops every tombstone.
+    void shrink_to_fit() {
+        size_t fit = Capacity::roundUp(capacityFor(sz));
+        if (fit < slots.size()) rehash(fit);
+    }
+
+private:
+    using SlotAllocator =
+        typename std::allocator_traits<Allocator>::template rebind_alloc<Slot>;
+
+    // An all-zero slot is empty, so with the zero-filling allocators a
+    // fresh array needs no initialisation
+    void allocate(size_t capacity) {
+        std::vector<Slot, SlotAllocator>(capacity, slots.get_allocator())
+            .swap(slots);
+        cap.resize(capacity);
+    }
+
+    // Smallest capacity that keeps n keys within the 0.7 load factor
+    static size_t capacityFor(size_t n) { return (n * 10 + 6) / 7; }
+
+    size_t displacement(size_t idx) const {
+        size_t home = hashFunc(slots[idx].key, cap);
+        return idx >= home ? idx - home : idx + slots.size() - home;
+    }
+
+    bool containsFrom(int key, size_t idx) const {
+        size_t probes = 0;
+        size_t tombstones = 0;
+        bool found = probeContains(slots.data(), cap, key, idx, probes,
+                                   tombstones);
+        recordProbes(&ProbeStats::lookup, probes, tombstones);
+        return found;
+    }
+
+    // Lookup shared by owned and mapped slot arrays
+    static bool probeContains(const Slot* slots, const Capacity& cap, int key,
+                              size_t idx) {
+        size_t probes = 0;
+        size_t tombstones = 0;
+        return probeContains(slots, cap, key, idx, probes, tombstones);
+    }
+
+    // As above, adding the slots examined and the tombstones among them
+    static bool probeContains(const Slot* slots, const Capacity& cap, int key,
+                              size_t idx, size_t& probes, size_t& tombstones) {
+        return probeFind(
+                   cap, idx, [&](size_t i) { return slots[i].state; },
+                   [&](size_t i) { return slots[i].key == key; }, probes,
+                   tombstones) != probeNotFound;
+    }
+
+    bool removeFrom(int key, size_t idx) {
+        size_t start = idx;
+        size_t probes = 1;
+        size_t tombstones = 0;
+        while (slots[idx].state != State::Empty) {
+            if (slots[idx].state == State::Filled && slots[idx].key == key) {
+                if (Erase == EraseMode::BackwardShift) {
+                    backwardShift(idx);
+                } else {
+                    slots[idx].state = State::Deleted;
+                    ++deleted;
+                }
+                --sz;
+                recordProbes(&ProbeStats::erase, probes, tombstones);
+                return true;
+            }
+            if (slots[idx].state == State::Deleted) ++tombstones;
+            idx = cap.next(idx);
+            if (idx == start) break;
+            ++probes;
+        }
+        recordProbes(&ProbeStats::erase, probes, tombstones);
+        return false;
+    }
+
+    // Add one operation to the probe counters; a no-op without
+    // FIBHASH_PROBE_STATS
+    void recordProbes([[maybe_unused]] ProbeStats::Op ProbeStats::*op,
+                      [[maybe_unused]] size_t probes,
+                      [[maybe_unused]] size_t tombstones) const {
+#if FIBHASH_PROBE_STATS
+        stats.record(stats.*op, probes, tombstones);
+#endif
+    }
+
+    // Keys hashed and prefetched ahead of the probe in the batch operations
+    static constexpr size_t batchWindow = 16;
+
+    size_t prefetchHome(int key) const {
+        size_t home = hashFunc(key, cap);
+        prefetch(&slots[home]);
+        return home;
+    }
+
+    // Call op(key, home, i) for every key of a batch, hashing and prefetching
+    // the home slot of the key batchWindow positions ahead first
+    template <typename Op>
+    void forBatch(const int* batch, size_t n, Op op) const {
+        size_t homes[batchWindow];
+        for (size_t i = 0; i < std::min(n, batchWindow); ++i)
+            homes[i] = prefetchHome(batch[i]);
+        for (size_t i = 0; i < n; ++i) {
+            size_t& slot = homes[i % batchWindow];
+            size_t home = slot;
+            if (i + batchWindow < n) slot = prefetchHome(batch[i + batchWindow]);
+            op(batch[i], home, i);
+        }
+    }
+
+    // Slots examined per SIMD group by scanSlots
+    static constexpr size_t scanGroup = 8;
+
+    // Keys gathered by scanSlots before each call of fn
+    static constexpr size_t scanBatch = 256;
+
+    // Call fn(keys, n) with the keys stored in slots [first, last), up to
+    // scanBatch at a time, until fn returns false. One compare tests the
+    // states of a whole group, so empty stretches cost a load per group.
+    template <typename Fn>
+    void scanSlots(size_t first, size_t last, Fn fn) const {
+        static_assert(sizeof(Slot) == 8 && offsetof(Slot, state) == 4,
+                      "matchTags8 expects the state at byte 4 of 8");
+        int keys[scanBatch];
+        size_t n = 0;
+        size_t i = first;
+        for (; i + scanGroup <= last; i += scanGroup) {
+            uint32_t mask = matchTags8(&slots[i], static_cast<uint8_t>(State::Filled));
+            for (; mask; mask &= mask - 1) keys[n++] = slots[i + lowestBit(mask)].key;
+            if (n > scanBatch - scanGroup) {
+                if (!fn(static_cast<const int*>(keys), n)) return;
+                n = 0;
+            }
+        }
+        for (; i < last; ++i)
+            if (slots[i].state == State::Filled) keys[n++] = slots[i].key;
+        if (n) fn(static_cast<const int*>(keys), n);
+    }
+
+    // Run fn(t, first, last) on `threads` threads, splitting [0, n) into
+    // contiguous ranges; a single range runs on the calling thread
+    template <typename Fn>
+    static void forRanges(size_t n, size_t threads, Fn fn) {
+        if (threads <= 1) {
+            fn(size_t{0}, size_t{0}, n);
+            return;
+        }
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; ++t)
+            workers.emplace_back(fn, t, n * t / threads, n * (t + 1) / threads);
+        for (auto& w : workers) w.join();
+    }
+
+    // Keys picked by `threads` threads. Each thread scans one range of the
+    // slots and calls pick(keys, n, out) to append the keys it keeps.
+    template <typename Pick>
+    std::vector<int> collect(size_t threads, Pick pick) const {
+        std::vector<std::vector<int>> parts(std::max<size_t>(threads, 1));
+        forRanges(slots.size(), threads, [&](size_t t, size_t first, size_t last) {
+            // Room for the range's share of the keys, so the part rarely
+            // has to be copied as it grows
+            parts[t].reserve(sz / parts.size() + scanBatch);
+            scanSlots(first, last, [&](const int* keys, size_t n) {
+                pick(keys, n, parts[t]);
+                return true;
+            });
+        });
+        if (parts.size() == 1) return std::move(parts[0]);
+        std::vector<int> keys;
+        for (const auto& part : parts) keys.insert(keys.end(), part.begin(), part.end());
+        return keys;
+    }
+
+    // Table of the keys of this table whose presence in other equals
+    // present. The keys are gathered first, so the result is sized for
+    // exactly the keys it gets; it shares this table's hash and allocator.
+    HashTable selectKeys(const HashTable& other, bool present,
+                         size_t threads) const {
+        std::vector<int> keys = collect(
+            threads, [&](const int* batch, size_t n, std::vector<int>& out) {
+                other.forBatch(batch, n, [&](int key, size_t home, size_t) {
+                    if (probeContains(other.slots.data(), other.cap, key,
+                                      home) == present)
+                        out.push_back(key);
+                });
+            });
+        HashTable result(capacityFor(keys.size()), hashFunc, get_allocator());
+        result.build(keys, threads);
+        return result;
+    }
+
+    // Insertion that may only probe slots [idx, end); returns false without
+    // touching the table if the probe reaches end. The key is only known to
+    // be absent once an Empty slot ends the probe, so even a tombstone seen
+    // on the way cannot be reused before that. reused counts the
+    // tombstones it fills.
+    bool insertBounded(int key, size_t idx, size_t end, size_t& added,
+                       size_t& reused) {
+        size_t tombstone = end;
+        for (; idx < end && slots[idx].state != State::Empty; ++idx) {
+            if (slots[idx].state == State::Filled) {
+                if (slots[idx].key == key) return true; // already in table
+            } else if (tombstone == end) {
+                tombstone = idx;
+            }
+        }
+        if (idx == end) return false;
+        if (tombstone != end) {
+            idx = tombstone;
+            ++reused;
+        }
+        slots[idx] = Slot{key, State::Filled};
+        ++added;
+        return true;
+    }
+
+    void insertInternal(int key, size_t idx) {
+        size_t probes = 0;
+        size_t tombstones = 0;
+        InsertProbe at = probeInsert(
+            cap, idx, [&](size_t i) { return slots[i].state; },
+            [&](size_t i) { return slots[i].key == key; }, probes, tombstones);
+        recordProbes(&ProbeStats::insert, probes, tombstones);
+        if (at.found) return; // already in table
+        if (at.reusesTombstone) --deleted;
+        slots[at.index] = Slot{key, State::Filled};
+        ++sz;
+    }
+
+    // Close the gap at hole by moving back every later entry of the cluster
+    // whose home slot does not lie cyclically in (hole, idx]
+    void backwardShift(size_t hole) {
+        size_t idx = cap.next(hole);
+        while (slots[idx].state == State::Filled) {
+            size_t home = hashFunc(slots[idx].key, cap);
+            bool stays = hole <= idx ? (hole < home && home <= idx)
+                                     : (hole < home || home <= idx);
+            if (!stays) {
+                slots[hole].key = slots[idx].key;
+                hole = idx;
+            }
+            idx = cap.next(idx);
+        }
+        slots[hole].state = State::Empty;
+    }
+
+    // Place a key known to be absent from a table without tombstones, so
+    // neither key comparisons nor tombstone checks are needed
+    void insertUnique(int key) {
+        size_t idx = hashFunc(key, cap);
+        while (slots[idx].state == State::Filled) idx = cap.next(idx);
+        slots[idx] = Slot{key, State::Filled};
+    }
+
+    // Swap the old array out instead of copying it, so a resize holds at
+    // most the old and the new array at once
+    void rehash(size_t newCapacity) {
+#if FIBHASH_PROBE_STATS
+        auto begin = std::chrono::steady_clock::now();
+#endif
+        std::vector<Slot, SlotAllocator> oldSlots(slots.get_allocator());
+        oldSlots.swap(slots);
+        allocate(newCapacity);
+        deleted = 0;
+        for (const Slot& slot : oldSlots) {
+            if (slot.state == State::Filled)
+                insertUnique(slot.key);
+        }
+#if FIBHASH_PROBE_STATS
+        ++stats.rehashes;
+        stats.rehashNs += static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - begin)
+                .count());
+#endif
+    }
+
+    // Same-capacity rehash without a second array. Every tombstone becomes
+    // empty and every key is marked Deleted, which here means not yet
+    // placed. Each unplaced key then goes to the first slot of its probe
+    // sequence that is not Filled. That slot is the key's own, an empty
+    // one, or one holding another unplaced key, which is swapped out and
+    // placed next. Placed keys never move again, so every key is moved at
+    // most once and no probe path ever crosses an empty slot.
+    void dropTombstones() {
+#if FIBHASH_PROBE_STATS
+        auto begin = std::chrono::steady_clock::now();
+#endif
+        for (Slot& slot : slots)
+            slot.state =
+                slot.state == State::Filled ? State::Deleted : State::Empty;
+        for (size_t i = 0; i < slots.size(); ++i) {
+            while (slots[i].state == State::Deleted) {
+                size_t idx = hashFunc(slots[i].key, cap);
+                while (slots[idx].state == State::Filled) idx = cap.next(idx);
+                if (idx == i) {
+                    slots[i].state = State::Filled;
+                } else if (slots[idx].state == State::Empty) {
+                    slots[idx] = Slot{slots[i].key, State::Filled};
+                    slots[i].state = State::Empty;
+                } else {
+                    std::swap(slots[i].key, slots[idx].key);
+                    slots[idx].state = State::Filled;
+                }
+            }
+        }
+        deleted = 0;
+        ++cleanupCount;
+#if FIBHASH_PROBE_STATS
+        ++stats.cleanups;
+        stats.cleanupNs += static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - begin)
+                .count());
+#endif
+    }
+
+    std::vector<Slot, SlotAllocator> slots;
+    size_t sz;
+    size_t deleted; // tombstones
+    size_t cleanupCount;
+    Capacity cap;
+    Hash hashFunc;
+#if FIBHASH_PROBE_STATS
+    mutable ProbeStats stats;
+#endif
+};
+
+} // namespace fibhash
+
+#endif // FIBHASH_HASH_TABLE_HPP
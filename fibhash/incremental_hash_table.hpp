@@ -0,0 +1,143 @@
+#ifndef FIBHASH_INCREMENTAL_HASH_TABLE_HPP
+#define FIBHASH_INCREMENTAL_HASH_TABLE_HPP
+
+#include "hash_table.hpp"
+
+#include <cstddef>
+#include <utility>
+
+namespace fibhash {
+
+// Linear probing table that resizes incrementally. Growing allocates the
+// larger table but leaves the keys where they are; every insert, lookup and
+// remove then moves the keys of the next migrationStep old slots across, so
+// no single operation pays for a full rehash. While a migration is running,
+// lookups check the new table and then the old one. Tombstones are dropped
+// the same way: a table crowded with them is migrated rather than rebuilt
+// in place. Once emptied, the old table is not freed in one go either; the
+// following operations return its pages releaseStep slots at a time.
+//
+// Because contains() migrates too, const calls from several threads need a
+// lock.
+template <typename Hash, typename Capacity = PowerOfTwoCapacity>
+class IncrementalHashTable {
+public:
+    using hasher = Hash;
+    using capacity_type = Capacity;
+    static constexpr const char* name = "Incremental";
+    static constexpr const char* erase_name = "Tombstone";
+    static constexpr const char* allocator_name =
+        HashTable<Hash, Capacity>::allocator_name;
+
+    explicit IncrementalHashTable(size_t capacity, Hash func = Hash())
+        : cur(capacity, func), migrated(0), released(0), hashFunc(func) {}
+
+    // Insert a key, starting a migration instead of a rehash when the new
+    // key would push the table over the 0.7 load factor, or when keys and
+    // tombstones crowd the table. The cleanup migration keeps the capacity
+    // if the keys fill at most half the load limit and grows otherwise, so
+    // it still ends before the new table fills up.
+    void insert(int key) {
+        migrate();
+        if (old && old->contains(key)) return;
+        if ((cur.size() + 1) * 10 > cur.capacity() * 7)
+            startMigration(Capacity::grow(cur.capacity()));
+        cur.insert(key);
+        if (!old && cur.needsCleanup())
+            startMigration(cur.size() * 20 > cur.capacity() * 7
+                               ? Capacity::grow(cur.capacity())
+                               : cur.capacity());
+    }
+
+    // Check if key is present
+    bool contains(int key) const {
+        migrate();
+        return cur.contains(key) || (old && old->contains(key));
+    }
+
+    // Remove a key if present
+    bool remove(int key) {
+        migrate();
+        return cur.remove(key) || (old && old->remove(key));
+    }
+
+    // Keys are guaranteed to be in one table while migrating
+    double loadFactor() const {
+        return static_cast<double>(size()) / cur.capacity();
+    }
+
+    size_t size() const { return cur.size() + (old ? old->size() : 0); }
+
+    double averageChainLength() const { return cur.averageChainLength(); }
+    size_t maxChainLength() const { return cur.maxChainLength(); }
+    double averageDisplacement() const { return cur.averageDisplacement(); }
+    size_t maxDisplacement() const { return cur.maxDisplacement(); }
+
+    // Bytes allocated for the tables, including an old one whose pages are
+    // still being released
+    size_t memoryUsage() const {
+        return cur.memoryUsage() + (old ? old->memoryUsage() : 0) +
+               (retired ? retired->memoryUsage() : 0);
+    }
+
+    // True while keys are still being moved out of the old table
+    bool migrating() const { return old != nullptr; }
+
+    // Clear the table
+    void clear() {
+        cur.clear();
+        old.reset();
+        retired.reset();
+    }
+
+private:
+    using Table = HashTable<Hash, Capacity, EraseMode::Tombstone,
+                            CacheAlignedAllocator<int>, false>;
+
+    // Old slots migrated per operation. The keys fill at most 35% of the
+    // new table when a migration starts, so it ends long before the new
+    // table reaches the load factor limit or needs a cleanup itself.
+    static constexpr size_t migrationStep = 16;
+
+    // Slots of an emptied table released per operation, 64 KiB of them.
+    // Freeing a large array at once unmaps all of its pages inside a single
+    // insert.
+    static constexpr size_t releaseStep = 8192;
+
+    void startMigration(size_t capacity) {
+        // Only possible after a long run of operations on one table
+        while (old || retired) migrate();
+        old = std::make_unique<Table>(std::move(cur));
+        cur = Table(capacity, hashFunc);
+        migrated = 0;
+    }
+
+    void migrate() const {
+        if (old) {
+            size_t last = std::min(migrated + migrationStep, old->capacity());
+            old->drainSlots(migrated, last, [this](int key) { cur.insert(key); });
+            migrated = last;
+            if (migrated == old->capacity()) {
+                retired = std::move(old);
+                released = 0;
+            }
+        } else if (retired) {
+            size_t last = std::min(released + releaseStep, retired->capacity());
+            retired->releaseSlots(released, last);
+            released = last;
+            if (released == retired->capacity()) retired.reset();
+        }
+    }
+
+    // contains() migrates as well, hence mutable
+    mutable Table cur;
+    mutable std::unique_ptr<Table> old;
+    mutable std::unique_ptr<Table> retired; // emptied, pages being released
+    mutable size_t migrated; // old slots below this index are already moved
+    mutable size_t released; // retired slots below this index are released
+    Hash hashFunc;
+};
+
+} // namespace fibhash
+
+#endif // FIBHASH_INCREMENTAL_HASH_TABLE_HPP
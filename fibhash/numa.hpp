@@ -0,0 +1,112 @@
+#ifndef FIBHASH_NUMA_HPP
+#define FIBHASH_NUMA_HPP
+
+#include "platform.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fibhash {
+
+// NUMA topology and thread placement through sysfs and raw system calls,
+// so the library needs no libnuma. Memory is placed by first touch: pages
+// land on the node of the thread that first writes them. Off Linux, and
+// wherever the topology cannot be read, there is a single node 0.
+
+// Numbers in a sysfs list such as "0-3,8,10-11"
+inline std::vector<unsigned> parseNumaList(const std::string& list) {
+    std::vector<unsigned> values;
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t end = list.find(',', pos);
+        if (end == std::string::npos) end = list.size();
+        std::string item = list.substr(pos, end - pos);
+        pos = end + 1;
+        if (item.empty() || item[0] < '0' || item[0] > '9') continue;
+        size_t dash = item.find('-');
+        unsigned first = static_cast<unsigned>(std::stoul(item.substr(0, dash)));
+        unsigned last = dash == std::string::npos
+                            ? first
+                            : static_cast<unsigned>(std::stoul(item.substr(dash + 1)));
+        for (unsigned v = first; v <= last; ++v) values.push_back(v);
+    }
+    return values;
+}
+
+// First line of a sysfs file, or an empty string
+inline std::string readSysfsLine(const std::string& path) {
+    std::ifstream in(path);
+    std::string line;
+    std::getline(in, line);
+    return line;
+}
+
+// Number of NUMA nodes, counting up to the highest online node
+inline size_t numaNodeCount() {
+#if defined(FIBHASH_HAVE_NUMA)
+    static const size_t count = [] {
+        std::vector<unsigned> nodes =
+            parseNumaList(readSysfsLine("/sys/devices/system/node/online"));
+        size_t highest = 0;
+        for (unsigned node : nodes) highest = std::max<size_t>(highest, node);
+        return nodes.empty() ? size_t(1) : highest + 1;
+    }();
+    return count;
+#else
+    return 1;
+#endif
+}
+
+// CPUs of node; empty if the topology cannot be read
+inline std::vector<unsigned> numaNodeCpus(unsigned node) {
+#if defined(FIBHASH_HAVE_NUMA)
+    return parseNumaList(readSysfsLine("/sys/devices/system/node/node" +
+                                       std::to_string(node) + "/cpulist"));
+#else
+    (void)node;
+    return {};
+#endif
+}
+
+// Node of the CPU the calling thread runs on right now
+inline unsigned currentNumaNode() {
+#if defined(FIBHASH_HAVE_NUMA) && defined(SYS_getcpu)
+    unsigned cpu = 0;
+    unsigned node = 0;
+    if (::syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) return node;
+#endif
+    return 0;
+}
+
+// Node of the calling thread, looked up on its first call and remembered.
+// Threads that should stay local are expected to be pinned before that.
+inline unsigned threadNumaNode() {
+    // Constant-initialised, so reading it needs no guard
+    thread_local unsigned node = ~0u;
+    if (node == ~0u) node = currentNumaNode();
+    return node;
+}
+
+// Restrict the calling thread to the CPUs of node. Returns false if the
+// node's CPUs are unknown or the affinity could not be set.
+inline bool pinThreadToNumaNode(unsigned node) {
+#if defined(FIBHASH_HAVE_NUMA)
+    std::vector<unsigned> cpus = numaNodeCpus(node);
+    if (cpus.empty()) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (unsigned cpu : cpus)
+        if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+    return ::sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)node;
+    return false;
+#endif
+}
+
+} // namespace fibhash
+
+#endif // FIBHASH_NUMA_HPP
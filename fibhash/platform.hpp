@@ -0,0 +1,52 @@
+#ifndef FIBHASH_PLATFORM_HPP
+#define FIBHASH_PLATFORM_HPP
+
+#include <cstddef>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#define FIBHASH_HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#define FIBHASH_HAVE_NUMA 1
+#include <sched.h>
+#include <sys/syscall.h>
+#include <linux/membarrier.h>
+#if defined(SYS_membarrier)
+#define FIBHASH_HAVE_MEMBARRIER 1
+#endif
+#endif
+
+// Build with -DFIBHASH_PROBE_STATS=1 to make HashTable count its probes.
+// The counters compile out otherwise.
+#ifndef FIBHASH_PROBE_STATS
+#define FIBHASH_PROBE_STATS 0
+#endif
+
+namespace fibhash {
+
+// Size of a cache line on the targets we benchmark
+constexpr size_t cacheLineSize = 64;
+
+// Hint that p will be read soon
+inline void prefetch(const void* p) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(p);
+#else
+    (void)p;
+#endif
+}
+
+} // namespace fibhash
+
+#endif // FIBHASH_PLATFORM_HPP
@@ -0,0 +1,76 @@
+#ifndef FIBHASH_PROBE_HPP
+#define FIBHASH_PROBE_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace fibhash {
+
+// Probe core shared by HashTable and HashMap, which store their slots
+// differently but walk them the same way. stateAt(i) returns the SlotState
+// of slot i and matches(i) tells whether the filled slot i holds the key.
+
+enum class SlotState : uint8_t { Empty, Filled, Deleted };
+
+// Keys and tombstones together may fill this share of the slots before a
+// table rehashes at its current capacity
+constexpr double maxOccupied = 0.8;
+
+constexpr size_t probeNotFound = static_cast<size_t>(-1);
+
+// Slot holding the key, or probeNotFound. An empty slot or a full lap ends
+// the probe. probes counts the slots examined and tombstones the deleted
+// ones among them.
+template <typename Capacity, typename StateAt, typename Matches>
+inline size_t probeFind(const Capacity& cap, size_t idx, StateAt stateAt,
+                        Matches matches, size_t& probes, size_t& tombstones) {
+    size_t start = idx;
+    ++probes;
+    while (stateAt(idx) != SlotState::Empty) {
+        if (stateAt(idx) == SlotState::Filled) {
+            if (matches(idx)) return idx;
+        } else {
+            ++tombstones;
+        }
+        idx = cap.next(idx);
+        if (idx == start) break;
+        ++probes;
+    }
+    return probeNotFound;
+}
+
+// Where an insert of the key lands
+struct InsertProbe {
+    size_t index;         // slot holding the key, or the one to store it in
+    bool found;           // the key is already stored at index
+    bool reusesTombstone; // index is a tombstone on the key's probe path
+};
+
+// Probe for the key as an insert would. A tombstone on the way is only
+// reused once the rest of the probe proves the key absent. The caller keeps
+// a free slot in the table, so a full lap still finds one.
+template <typename Capacity, typename StateAt, typename Matches>
+inline InsertProbe probeInsert(const Capacity& cap, size_t idx, StateAt stateAt,
+                               Matches matches, size_t& probes,
+                               size_t& tombstones) {
+    size_t start = idx;
+    size_t tombstone = probeNotFound;
+    ++probes;
+    while (stateAt(idx) != SlotState::Empty) {
+        if (stateAt(idx) == SlotState::Filled) {
+            if (matches(idx)) return {idx, true, false};
+        } else {
+            ++tombstones;
+            if (tombstone == probeNotFound) tombstone = idx;
+        }
+        idx = cap.next(idx);
+        if (idx == start) break;
+        ++probes;
+    }
+    if (tombstone != probeNotFound) return {tombstone, false, true};
+    return {idx, false, false};
+}
+
+} // namespace fibhash
+
+#endif // FIBHASH_PROBE_HPP
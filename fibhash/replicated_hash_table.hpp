@@ -0,0 +1,162 @@
+#ifndef FIBHASH_REPLICATED_HASH_TABLE_HPP
+#define FIBHASH_REPLICATED_HASH_TABLE_HPP
+
+#include "capacity.hpp"
+#include "concurrent_hash_table.hpp"
+#include "numa.hpp"
+#include "platform.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fibhash {
+
+// Read-mostly set keeping one full replica per NUMA node, so a lookup never
+// crosses the socket interconnect. Replicas are LockFreeReadHashTables: they
+// take writes while being read, and their arrays are filled in by the
+// thread that allocates them. Every replica is created and written only by
+// a thread pinned to its node, so by first touch its slot arrays, including
+// those of later resizes, live on that node.
+//
+// contains() is wait-free and reads the replica of the calling thread's
+// node (see threadNumaNode). Writes are queued and applied to every replica
+// in batches of writeBatch, either when the queue fills or on flush();
+// until then lookups do not see them. On a host with one node there is one
+// replica, written by the calling thread.
+template <typename Capacity = PowerOfTwoCapacity>
+class ReplicatedHashTable {
+public:
+    static constexpr const char* name = "Replicated";
+
+    // Queued writes that trigger an automatic flush
+    static constexpr size_t writeBatch = 4096;
+
+    // capacity is that of each replica. There is one replica per node by
+    // default; replica r lives on node r modulo the node count.
+    explicit ReplicatedHashTable(size_t capacity,
+                                 size_t replicaCount = numaNodeCount()) {
+        replicas.resize(std::max<size_t>(replicaCount, 1));
+        for (size_t node = 0; node < numaNodeCount(); ++node)
+            replicaOfNode.push_back(node % replicas.size());
+        onEachReplica([&](size_t r) {
+            replicas[r] = std::make_unique<Replica>(capacity);
+        });
+    }
+
+    // Add keys to every replica, after the queued writes
+    void build(const std::vector<int>& keys) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        apply(pending);
+        pending.clear();
+        onEachReplica([&](size_t r) {
+            for (int key : keys) replicas[r]->insert(key);
+        });
+    }
+
+    void insert(int key) { queue({key, true}); }
+    void remove(int key) { queue({key, false}); }
+
+    // Apply every queued write to every replica
+    void flush() {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        apply(pending);
+        pending.clear();
+    }
+
+    bool contains(int key) const {
+        return containsOn(replicaFor(threadNumaNode()), key);
+    }
+
+    // Look key up in a given replica, wherever the caller runs
+    bool containsOn(size_t replica, int key) const {
+        return replicas[replica]->contains(key);
+    }
+
+    // Replica serving threads on node; a table lookup, since a division
+    // would cost a good share of a lookup
+    size_t replicaFor(unsigned node) const {
+        return node < replicaOfNode.size() ? replicaOfNode[node] : 0;
+    }
+
+    size_t replicaCount() const { return replicas.size(); }
+
+    unsigned nodeOf(size_t replica) const {
+        return static_cast<unsigned>(replica % numaNodeCount());
+    }
+
+    // Keys in the replicas, not counting queued writes
+    size_t size() const { return replicas[0]->size(); }
+
+    size_t pendingWrites() const {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        return pending.size();
+    }
+
+    // Bytes allocated for the arrays of all replicas
+    size_t memoryUsage() const {
+        size_t total = 0;
+        for (const auto& r : replicas) total += r->memoryUsage();
+        return total;
+    }
+
+private:
+    using Replica = LockFreeReadHashTable<Capacity>;
+
+    struct Write {
+        int key;
+        bool insert;
+    };
+
+    // Call fn(r) for every replica on a thread pinned to its node, or on
+    // the calling thread when there is a single replica
+    template <typename Fn>
+    void onEachReplica(Fn fn) {
+        if (replicas.size() == 1) {
+            fn(size_t{0});
+            return;
+        }
+        std::vector<std::thread> workers;
+        for (size_t r = 0; r < replicas.size(); ++r)
+            workers.emplace_back([&, r] {
+                pinThreadToNumaNode(nodeOf(r));
+                fn(r);
+            });
+        for (auto& w : workers) w.join();
+    }
+
+    void queue(Write write) {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        pending.push_back(write);
+        if (pending.size() >= writeBatch) {
+            apply(pending);
+            pending.clear();
+        }
+    }
+
+    // Apply a batch of writes in order to every replica. The caller holds
+    // writeMutex, so batches reach all replicas in the same order.
+    void apply(const std::vector<Write>& batch) {
+        if (batch.empty()) return;
+        onEachReplica([&](size_t r) {
+            for (const Write& w : batch) {
+                if (w.insert)
+                    replicas[r]->insert(w.key);
+                else
+                    replicas[r]->remove(w.key);
+            }
+        });
+    }
+
+    std::vector<std::unique_ptr<Replica>> replicas;
+    std::vector<size_t> replicaOfNode;
+    mutable std::mutex writeMutex;
+    std::vector<Write> pending;
+};
+
+} // namespace fibhash
+
+#endif // FIBHASH_REPLICATED_HASH_TABLE_HPP
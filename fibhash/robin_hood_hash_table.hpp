@@ -0,0 +1,195 @@
+#ifndef FIBHASH_ROBIN_HOOD_HASH_TABLE_HPP
+#define FIBHASH_ROBIN_HOOD_HASH_TABLE_HPP
+
+#include "capacity.hpp"
+#include "hash.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace fibhash {
+
+// Linear probing with Robin Hood insertion. Each slot stores one byte with
+// its key's distance from home plus one (0 marks an empty slot). On insert a
+// key takes the slot of any richer (less displaced) key, which evens out
+// probe lengths, and a lookup stops as soon as it meets a key closer to home
+// than itself. Deletion always shifts back, so there are no tombstones.
+template <typename Hash, typename Capacity = PowerOfTwoCapacity>
+class RobinHoodHashTable {
+public:
+    using hasher = Hash;
+    using capacity_type = Capacity;
+    static constexpr const char* name = "RobinHood";
+    static constexpr const char* erase_name = "BackwardShift";
+
+    explicit RobinHoodHashTable(size_t capacity, Hash func = Hash())
+        : sz(0), hashFunc(func) {
+        allocate(Capacity::roundUp(capacity));
+    }
+
+    // Insert a key, growing the table when it is too full or a key would be
+    // displaced further than the distance byte can record
+    void insert(int key) {
+        place(key);
+        if (loadFactor() > 0.7) {
+            rehash(Capacity::grow(keys.size()));
+        }
+    }
+
+    // Check if key is present
+    bool contains(int key) const {
+        size_t idx = hashFunc(key, cap);
+        for (unsigned d = 1; dist[idx] >= d; ++d) {
+            if (keys[idx] == key) return true;
+            idx = cap.next(idx);
+        }
+        return false;
+    }
+
+    // Remove a key if present
+    bool remove(int key) {
+        size_t idx = hashFunc(key, cap);
+        for (unsigned d = 1; dist[idx] >= d; ++d) {
+            if (keys[idx] == key) {
+                size_t next = cap.next(idx);
+                while (dist[next] > 1) {
+                    keys[idx] = keys[next];
+                    dist[idx] = static_cast<uint8_t>(dist[next] - 1);
+                    idx = next;
+                    next = cap.next(next);
+                }
+                dist[idx] = 0;
+                --sz;
+                return true;
+            }
+            idx = cap.next(idx);
+        }
+        return false;
+    }
+
+    // Current load factor
+    double loadFactor() const { return static_cast<double>(sz) / keys.size(); }
+
+    size_t size() const { return sz; }
+
+    // Average cluster length (contiguous filled slots)
+    double averageChainLength() const {
+        size_t clusterCount = 0;
+        size_t total = 0;
+        for (size_t i = 0; i < keys.size();) {
+            if (dist[i] != 0) {
+                while (i < keys.size() && dist[i] != 0) {
+                    ++total;
+                    ++i;
+                }
+                ++clusterCount;
+            } else {
+                ++i;
+            }
+        }
+        if (clusterCount == 0) return 0.0;
+        return static_cast<double>(total) / clusterCount;
+    }
+
+    // Maximum cluster length
+    size_t maxChainLength() const {
+        size_t maxLen = 0;
+        size_t len = 0;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            len = dist[i] != 0 ? len + 1 : 0;
+            if (len > maxLen) maxLen = len;
+        }
+        return maxLen;
+    }
+
+    // Mean distance of stored keys from their home slot
+    double averageDisplacement() const {
+        if (sz == 0) return 0.0;
+        size_t total = 0;
+        for (uint8_t d : dist)
+            if (d != 0) total += d - 1;
+        return static_cast<double>(total) / sz;
+    }
+
+    // Largest distance of a stored key from its home slot
+    size_t maxDisplacement() const {
+        size_t maxDist = 0;
+        for (uint8_t d : dist)
+            if (d != 0 && static_cast<size_t>(d - 1) > maxDist) maxDist = d - 1;
+        return maxDist;
+    }
+
+    // Estimated memory usage in bytes
+    size_t memoryUsage() const {
+        return keys.size() * (sizeof(int) + sizeof(uint8_t));
+    }
+
+    // Clear the table
+    void clear() {
+        std::fill(dist.begin(), dist.end(), 0);
+        sz = 0;
+    }
+
+private:
+    // Distance bytes store displacement + 1, so 255 can never be stored
+    static constexpr unsigned maxDist = 255;
+
+    void allocate(size_t capacity) {
+        keys.assign(capacity, 0);
+        dist.assign(capacity, 0);
+        cap.resize(capacity);
+    }
+
+    // Robin Hood insertion. Returns false if some key would need a distance
+    // of maxDist; key is then set to the key still waiting for a slot.
+    bool insertInternal(int& key) {
+        size_t idx = hashFunc(key, cap);
+        unsigned d = 1;
+        while (dist[idx] >= d) {
+            if (keys[idx] == key)
+                return true; // already in table
+            idx = cap.next(idx);
+            if (++d == maxDist) return false;
+        }
+        while (dist[idx] != 0) {
+            if (dist[idx] < d) {
+                std::swap(key, keys[idx]);
+                uint8_t displaced = dist[idx];
+                dist[idx] = static_cast<uint8_t>(d);
+                d = displaced;
+            }
+            idx = cap.next(idx);
+            if (++d == maxDist) return false;
+        }
+        keys[idx] = key;
+        dist[idx] = static_cast<uint8_t>(d);
+        ++sz;
+        return true;
+    }
+
+    void place(int key) {
+        while (!insertInternal(key)) rehash(Capacity::grow(keys.size()));
+    }
+
+    void rehash(size_t newCapacity) {
+        std::vector<int> oldKeys = std::move(keys);
+        std::vector<uint8_t> oldDist = std::move(dist);
+        allocate(newCapacity);
+        sz = 0;
+        for (size_t i = 0; i < oldKeys.size(); ++i) {
+            if (oldDist[i] != 0) place(oldKeys[i]);
+        }
+    }
+
+    std::vector<int> keys;
+    std::vector<uint8_t> dist;
+    size_t sz;
+    Capacity cap;
+    Hash hashFunc;
+};
+
+} // namespace fibhash
+
+#endif // FIBHASH_ROBIN_HOOD_HASH_TABLE_HPP
@@ -0,0 +1,84 @@
+#ifndef FIBHASH_SIMD_HPP
+#define FIBHASH_SIMD_HPP
+
+#include "platform.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace fibhash {
+
+// Index of the lowest set bit of a non-zero group bitmask
+inline unsigned lowestBit(uint32_t mask) {
+    return static_cast<unsigned>(__builtin_ctz(mask));
+}
+
+// Index of key among the first n entries of keys, or -1. keys holds
+// N >= n ints, N a multiple of 4, and is scanned four keys per compare
+// where SSE2 or NEON is available.
+template <size_t N>
+inline int scanKeys(const int* keys, size_t n, int key) {
+    static_assert(N % 4 == 0 && N <= 32, "scanned in lanes of four");
+    uint32_t mask = 0;
+#if defined(__SSE2__)
+    __m128i needle = _mm_set1_epi32(key);
+    for (size_t i = 0; i < N; i += 4) {
+        __m128i lanes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i));
+        mask |= static_cast<uint32_t>(_mm_movemask_ps(
+                    _mm_castsi128_ps(_mm_cmpeq_epi32(lanes, needle))))
+                << i;
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    static const uint32_t bit[4] = {1, 2, 4, 8};
+    int32x4_t needle = vdupq_n_s32(key);
+    for (size_t i = 0; i < N; i += 4) {
+        uint32x4_t eq = vceqq_s32(vld1q_s32(keys + i), needle);
+        mask |= vaddvq_u32(vandq_u32(eq, vld1q_u32(bit))) << i;
+    }
+#else
+    for (size_t i = 0; i < N; ++i)
+        if (keys[i] == key) mask |= 1u << i;
+#endif
+    if (n < 32) mask &= (1u << n) - 1;
+    return mask ? static_cast<int>(lowestBit(mask)) : -1;
+}
+
+// Bitmask of which of the eight 8-byte slots at p carry tag. A slot is an
+// int followed by a one-byte tag and padding, as in HashTable: the tag is
+// the byte at offset 4, and the padding after it is masked off.
+inline uint32_t matchTags8(const void* p, uint8_t tag) {
+    uint32_t mask = 0;
+#if defined(__SSE2__)
+    const __m128i* words = static_cast<const __m128i*>(p);
+    const __m128i low = _mm_set1_epi32(0xFF);
+    const __m128i needle = _mm_set1_epi32(tag);
+    for (size_t i = 0; i < 4; i += 2) {
+        // Second words of four slots side by side
+        __m128 tags = _mm_shuffle_ps(_mm_castsi128_ps(_mm_loadu_si128(words + i)),
+                                     _mm_castsi128_ps(_mm_loadu_si128(words + i + 1)),
+                                     _MM_SHUFFLE(3, 1, 3, 1));
+        __m128i eq = _mm_cmpeq_epi32(_mm_and_si128(_mm_castps_si128(tags), low),
+                                     needle);
+        mask |= static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(eq)))
+                << (i * 2);
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    static const uint32_t bit[4] = {1, 2, 4, 8};
+    const uint32_t* words = static_cast<const uint32_t*>(p);
+    for (size_t i = 0; i < 8; i += 4) {
+        uint32x4_t tags = vandq_u32(vld2q_u32(words + i * 2).val[1],
+                                    vdupq_n_u32(0xFF));
+        uint32x4_t eq = vceqq_u32(tags, vdupq_n_u32(tag));
+        mask |= vaddvq_u32(vandq_u32(eq, vld1q_u32(bit))) << i;
+    }
+#else
+    const unsigned char* bytes = static_cast<const unsigned char*>(p);
+    for (size_t i = 0; i < 8; ++i)
+        if (bytes[i * 8 + 4] == tag) mask |= 1u << i;
+#endif
+    return mask;
+}
+
+} // namespace fibhash
+
+#endif // FIBHASH_SIMD_HPP
@@ -0,0 +1,114 @@
+#ifndef FIBHASH_SMALL_HASH_TABLE_HPP
+#define FIBHASH_SMALL_HASH_TABLE_HPP
+
+#include "hash_table.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+
+namespace fibhash {
+
+// HashTable with inline storage for small sets. Up to N keys live in an
+// array inside the object and are found with one vectorised scan, so a
+// table that stays small never touches the heap. The first insert past N
+// moves the keys into a HashTable, which serves every later operation;
+// clear() returns to the inline array. The capacity hint only sizes that
+// HashTable.
+template <typename Hash, typename Capacity = PowerOfTwoCapacity,
+          size_t N = 16>
+class SmallHashTable {
+public:
+    using hasher = Hash;
+    using capacity_type = Capacity;
+    using Table = HashTable<Hash, Capacity>;
+    static constexpr const char* name = "Small";
+    static constexpr const char* erase_name = Table::erase_name;
+    static constexpr const char* allocator_name = Table::allocator_name;
+    static constexpr size_t inlineCapacity = N;
+
+    explicit SmallHashTable(size_t capacity = 0, Hash func = Hash())
+        : keys{}, count(0), hint(capacity), hashFunc(func) {}
+
+    void insert(int key) {
+        if (table) {
+            table->insert(key);
+            return;
+        }
+        if (scanKeys<N>(keys, count, key) >= 0) return;
+        if (count < N) {
+            keys[count++] = key;
+            return;
+        }
+        spill();
+        table->insert(key);
+    }
+
+    bool contains(int key) const {
+        if (table) return table->contains(key);
+        return scanKeys<N>(keys, count, key) >= 0;
+    }
+
+    bool remove(int key) {
+        if (table) return table->remove(key);
+        int idx = scanKeys<N>(keys, count, key);
+        if (idx < 0) return false;
+        keys[idx] = keys[--count];
+        return true;
+    }
+
+    // True while the keys are held inline
+    bool isInline() const { return !table; }
+
+    size_t size() const { return table ? table->size() : count; }
+    size_t capacity() const { return table ? table->capacity() : N; }
+
+    double loadFactor() const {
+        return table ? table->loadFactor() : static_cast<double>(count) / N;
+    }
+
+    // The inline keys form a single cluster with no displacement
+    double averageChainLength() const {
+        return table ? table->averageChainLength() : static_cast<double>(count);
+    }
+
+    size_t maxChainLength() const {
+        return table ? table->maxChainLength() : count;
+    }
+
+    double averageDisplacement() const {
+        return table ? table->averageDisplacement() : 0.0;
+    }
+
+    size_t maxDisplacement() const {
+        return table ? table->maxDisplacement() : 0;
+    }
+
+    // Heap bytes in use; 0 while inline
+    size_t memoryUsage() const { return table ? table->memoryUsage() : 0; }
+
+    // Remove every key and release the hashed layout
+    void clear() {
+        table.reset();
+        count = 0;
+    }
+
+private:
+    // Move the inline keys into a HashTable sized for at least 2N keys
+    void spill() {
+        table.emplace(std::max(hint, 2 * N), hashFunc);
+        for (size_t i = 0; i < count; ++i) table->insert(keys[i]);
+        count = 0;
+    }
+
+    alignas(16) int keys[N];
+    size_t count;
+    size_t hint;
+    std::optional<Table> table;
+    Hash hashFunc;
+};
+
+} // namespace fibhash
+
+#endif // FIBHASH_SMALL_HASH_TABLE_HPP
@@ -0,0 +1,263 @@
+#ifndef FIBHASH_STRING_HASH_TABLE_HPP
+#define FIBHASH_STRING_HASH_TABLE_HPP
+
+#include "allocator.hpp"
+#include "capacity.hpp"
+#include "hash.hpp"
+#include "probe.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace fibhash {
+
+// 64-bit string hash in the style of MurmurHash64A: eight bytes at a time
+// through a multiply-xorshift mix. Tables store the result, so a key is
+// hashed once however often the table grows.
+inline uint64_t hashString(std::string_view s) {
+    const uint64_t m = 0xC6A4A7935BD1E995ull;
+    uint64_t h = 0x8445D61A4E774912ull ^ (s.size() * m);
+    const char* p = s.data();
+    size_t n = s.size();
+    for (; n >= 8; p += 8, n -= 8) {
+        uint64_t k;
+        std::memcpy(&k, p, 8);
+        k *= m;
+        k ^= k >> 47;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+    if (n) {
+        uint64_t k = 0;
+        std::memcpy(&k, p, n);
+        h ^= k;
+        h *= m;
+    }
+    h ^= h >> 47;
+    h *= m;
+    h ^= h >> 47;
+    return h;
+}
+
+// Open addressing set of strings using linear probing. Every slot keeps the
+// key's full 64-bit hash in an array of its own, so probes walk densely
+// packed hashes and only compare strings whose hash matches, and a rehash
+// places keys by their stored hash without reading the strings. The Hash
+// policy reduces the stored hash to a slot, so FibonacciHash applies its
+// 64-bit multiply on top of hashString. Every lookup takes a
+// std::string_view; a std::string is only built when a key is inserted.
+template <typename Hash = FibonacciHash, typename Capacity = PowerOfTwoCapacity>
+class StringHashTable {
+public:
+    using hasher = Hash;
+    using capacity_type = Capacity;
+    static constexpr const char* name = "String";
+    static constexpr const char* erase_name = "Tombstone";
+
+    explicit StringHashTable(size_t capacity, Hash func = Hash())
+        : sz(0), deleted(0), hashFunc(func) {
+        allocate(Capacity::roundUp(capacity));
+    }
+
+    // Insert a key. Tombstones lengthen probes like keys do, so once keys
+    // and tombstones together fill maxOccupied of the slots the table is
+    // rehashed at the same capacity.
+    void insert(std::string_view key) {
+        uint64_t h = hashOf(key);
+        size_t idx = hashFunc(h, cap);
+        size_t start = idx;
+        size_t tombstone = hashes.size();
+        while (hashes[idx] != emptyHash) {
+            if (hashes[idx] == h && keys[idx] == key) return;
+            if (hashes[idx] == deletedHash && tombstone == hashes.size())
+                tombstone = idx;
+            idx = cap.next(idx);
+            if (idx == start) break;
+        }
+        if (tombstone != hashes.size()) {
+            idx = tombstone;
+            --deleted;
+        }
+        hashes[idx] = h;
+        keys[idx].assign(key.data(), key.size());
+        ++sz;
+        if (loadFactor() > 0.7) {
+            rehash(Capacity::grow(hashes.size()));
+        } else if (static_cast<double>(sz + deleted) >
+                   maxOccupied * hashes.size()) {
+            rehash(hashes.size());
+        }
+    }
+
+    bool contains(std::string_view key) const { return find(key) != npos; }
+
+    bool remove(std::string_view key) {
+        size_t idx = find(key);
+        if (idx == npos) return false;
+        hashes[idx] = deletedHash;
+        std::string().swap(keys[idx]);
+        --sz;
+        ++deleted;
+        return true;
+    }
+
+    double loadFactor() const {
+        return static_cast<double>(sz) / hashes.size();
+    }
+
+    size_t size() const { return sz; }
+    size_t capacity() const { return hashes.size(); }
+
+    // Slots holding a tombstone
+    size_t tombstones() const { return deleted; }
+
+    // Average cluster length (contiguous filled slots)
+    double averageChainLength() const {
+        size_t clusterCount = 0;
+        size_t total = 0;
+        for (size_t i = 0; i < hashes.size();) {
+            if (filled(i)) {
+                size_t len = 0;
+                while (i < hashes.size() && filled(i)) {
+                    ++len;
+                    ++i;
+                }
+                ++clusterCount;
+                total += len;
+            } else {
+                ++i;
+            }
+        }
+        if (clusterCount == 0) return 0.0;
+        return static_cast<double>(total) / clusterCount;
+    }
+
+    // Maximum cluster length
+    size_t maxChainLength() const {
+        size_t maxLen = 0;
+        for (size_t i = 0; i < hashes.size();) {
+            if (filled(i)) {
+                size_t len = 0;
+                while (i < hashes.size() && filled(i)) {
+                    ++len;
+                    ++i;
+                }
+                if (len > maxLen) maxLen = len;
+            } else {
+                ++i;
+            }
+        }
+        return maxLen;
+    }
+
+    // Mean distance of stored keys from their home slot
+    double averageDisplacement() const {
+        if (sz == 0) return 0.0;
+        size_t total = 0;
+        for (size_t i = 0; i < hashes.size(); ++i)
+            if (filled(i)) total += displacement(i);
+        return static_cast<double>(total) / sz;
+    }
+
+    // Largest distance of a stored key from its home slot
+    size_t maxDisplacement() const {
+        size_t maxDist = 0;
+        for (size_t i = 0; i < hashes.size(); ++i)
+            if (filled(i)) maxDist = std::max(maxDist, displacement(i));
+        return maxDist;
+    }
+
+    // Bytes for both slot arrays plus the heap buffers of long keys
+    size_t memoryUsage() const {
+        size_t bytes = HashAllocator::allocationSize(hashes.capacity()) +
+                       keys.capacity() * sizeof(std::string);
+        for (const std::string& k : keys) {
+            const char* object = reinterpret_cast<const char*>(&k);
+            if (k.data() < object || k.data() >= object + sizeof(k))
+                bytes += k.capacity() + 1;
+        }
+        return bytes;
+    }
+
+    // Remove every key, keeping the capacity
+    void clear() {
+        for (size_t i = 0; i < hashes.size(); ++i) {
+            hashes[i] = emptyHash;
+            std::string().swap(keys[i]);
+        }
+        sz = 0;
+        deleted = 0;
+    }
+
+private:
+    using HashAllocator = CacheAlignedAllocator<uint64_t>;
+
+    // Stored hashes 0 and 1 mark empty and deleted slots
+    static constexpr uint64_t emptyHash = 0;
+    static constexpr uint64_t deletedHash = 1;
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    static uint64_t hashOf(std::string_view key) {
+        uint64_t h = hashString(key);
+        return h > deletedHash ? h : h + 2;
+    }
+
+    bool filled(size_t idx) const { return hashes[idx] > deletedHash; }
+
+    size_t displacement(size_t idx) const {
+        size_t home = hashFunc(hashes[idx], cap);
+        return idx >= home ? idx - home : idx + hashes.size() - home;
+    }
+
+    size_t find(std::string_view key) const {
+        uint64_t h = hashOf(key);
+        size_t idx = hashFunc(h, cap);
+        size_t start = idx;
+        while (hashes[idx] != emptyHash) {
+            if (hashes[idx] == h && keys[idx] == key) return idx;
+            idx = cap.next(idx);
+            if (idx == start) break;
+        }
+        return npos;
+    }
+
+    // An all-zero hash array is empty, so it needs no initialisation
+    void allocate(size_t capacity) {
+        std::vector<uint64_t, HashAllocator>(capacity).swap(hashes);
+        std::vector<std::string>(capacity).swap(keys);
+        cap.resize(capacity);
+    }
+
+    // Place every key anew in an array without tombstones
+    void rehash(size_t newCapacity) {
+        std::vector<uint64_t, HashAllocator> oldHashes;
+        std::vector<std::string> oldKeys;
+        oldHashes.swap(hashes);
+        oldKeys.swap(keys);
+        allocate(newCapacity);
+        deleted = 0;
+        for (size_t i = 0; i < oldHashes.size(); ++i) {
+            if (oldHashes[i] <= deletedHash) continue;
+            size_t idx = hashFunc(oldHashes[i], cap);
+            while (hashes[idx] != emptyHash) idx = cap.next(idx);
+            hashes[idx] = oldHashes[i];
+            keys[idx] = std::move(oldKeys[i]);
+        }
+    }
+
+    std::vector<uint64_t, HashAllocator> hashes;
+    std::vector<std::string> keys;
+    size_t sz;
+    size_t deleted; // tombstones
+    Capacity cap;
+    Hash hashFunc;
+};
+
+} // namespace fibhash
+
+#endif // FIBHASH_STRING_HASH_TABLE_HPP
@@ -0,0 +1,301 @@
+#ifndef FIBHASH_SWISS_HASH_TABLE_HPP
+#define FIBHASH_SWISS_HASH_TABLE_HPP
+
+#include "allocator.hpp"
+#include "capacity.hpp"
+#include "hash.hpp"
+#include "platform.hpp"
+#include "simd.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace fibhash {
+
+// Sixteen control bytes of a SwissHashTable scanned together. A byte holds
+// the top 7 bits of a stored key's Fibonacci hash, or one of the negative
+// markers below, so every match is a single vector compare plus a bitmask.
+class ControlGroup {
+public:
+    static constexpr size_t width = 16;
+    static constexpr int8_t Empty = -128;
+    static constexpr int8_t Deleted = -2;
+
+    explicit ControlGroup(const int8_t* ctrl) {
+#if defined(__SSE2__)
+        bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        bytes = vld1q_s8(ctrl);
+#else
+        std::copy(ctrl, ctrl + width, bytes);
+#endif
+    }
+
+    // Bit i is set if control byte i equals tag
+    uint32_t match(int8_t tag) const {
+#if defined(__SSE2__)
+        return static_cast<uint32_t>(_mm_movemask_epi8(
+            _mm_cmpeq_epi8(bytes, _mm_set1_epi8(tag))));
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        return toMask(vceqq_s8(bytes, vdupq_n_s8(tag)));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < width; ++i)
+            if (bytes[i] == tag) mask |= 1u << i;
+        return mask;
+#endif
+    }
+
+    uint32_t matchEmpty() const { return match(Empty); }
+
+    // Empty or deleted bytes, i.e. every byte with its sign bit set
+    uint32_t matchFree() const {
+#if defined(__SSE2__)
+        return static_cast<uint32_t>(_mm_movemask_epi8(bytes));
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        return toMask(vcltzq_s8(bytes));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < width; ++i)
+            if (bytes[i] < 0) mask |= 1u << i;
+        return mask;
+#endif
+    }
+
+private:
+#if defined(__SSE2__)
+    __m128i bytes;
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    // Collapse a byte-wise comparison result into one bit per lane
+    static uint32_t toMask(uint8x16_t eq) {
+        static const uint8_t bit[16] = {1, 2, 4, 8, 16, 32, 64, 128,
+                                        1, 2, 4, 8, 16, 32, 64, 128};
+        uint8x16_t masked = vandq_u8(eq, vld1q_u8(bit));
+        return vaddv_u8(vget_low_u8(masked)) |
+               (static_cast<uint32_t>(vaddv_u8(vget_high_u8(masked))) << 8);
+    }
+
+    int8x16_t bytes;
+#else
+    int8_t bytes[width];
+#endif
+};
+
+// SwissTable style open addressing. Slots are split into groups of
+// ControlGroup::width and probed group by group; the control bytes keep 7
+// bits of each key's hash, so a group is checked with one compare and a
+// lookup stops at the first group that still has an empty slot. The Hash
+// policy picks the home slot, so homes match the other tables, while the tag
+// comes from the top of the 64-bit Fibonacci product, which is independent of
+// the bits the policy used. Only power-of-two capacities are supported.
+template <typename Hash, typename Capacity = PowerOfTwoCapacity>
+class SwissHashTable {
+    static_assert(std::is_same<Capacity, PowerOfTwoCapacity>::value,
+                  "SwissHashTable needs power-of-two group counts");
+
+public:
+    using hasher = Hash;
+    using capacity_type = Capacity;
+    static constexpr const char* name = "Swiss";
+    static constexpr const char* erase_name = "Tombstone";
+
+    explicit SwissHashTable(size_t capacity, Hash func = Hash())
+        : sz(0), tombstones(0), hashFunc(func) {
+        allocate(roundCapacity(capacity));
+    }
+
+    // Insert a key, growing once 7/8 of the slots are in use as SwissTable
+    // does; a table mostly full of tombstones is rebuilt at the same size
+    void insert(int key) {
+        size_t group;
+        int8_t tag;
+        locate(key, group, tag);
+        if (find(key, group, tag) != npos) return;
+        size_t idx = firstFree(group);
+        if (ctrl[idx] == ControlGroup::Deleted) --tombstones;
+        keys[idx] = key;
+        ctrl[idx] = tag;
+        ++sz;
+        if ((sz + tombstones) * 8 > keys.size() * 7) {
+            rehash(sz * 2 > keys.size() ? Capacity::grow(keys.size())
+                                        : keys.size());
+        }
+    }
+
+    // Check if key is present
+    bool contains(int key) const {
+        size_t group;
+        int8_t tag;
+        locate(key, group, tag);
+        return find(key, group, tag) != npos;
+    }
+
+    // Remove a key if present. A slot whose group still has an empty byte
+    // becomes empty again, since no probe ever continued past that group.
+    bool remove(int key) {
+        size_t group;
+        int8_t tag;
+        locate(key, group, tag);
+        size_t idx = find(key, group, tag);
+        if (idx == npos) return false;
+        size_t base = idx & ~(ControlGroup::width - 1);
+        if (ControlGroup(&ctrl[base]).matchEmpty() != 0) {
+            ctrl[idx] = ControlGroup::Empty;
+        } else {
+            ctrl[idx] = ControlGroup::Deleted;
+            ++tombstones;
+        }
+        --sz;
+        return true;
+    }
+
+    // Current load factor
+    double loadFactor() const { return static_cast<double>(sz) / keys.size(); }
+
+    size_t size() const { return sz; }
+
+    // Average cluster length (contiguous filled slots)
+    double averageChainLength() const {
+        size_t clusterCount = 0;
+        size_t total = 0;
+        size_t len = 0;
+        for (size_t i = 0; i <= keys.size(); ++i) {
+            if (i < keys.size() && ctrl[i] >= 0) {
+                ++len;
+            } else if (len != 0) {
+                ++clusterCount;
+                total += len;
+                len = 0;
+            }
+        }
+        if (clusterCount == 0) return 0.0;
+        return static_cast<double>(total) / clusterCount;
+    }
+
+    // Maximum cluster length
+    size_t maxChainLength() const {
+        size_t maxLen = 0;
+        size_t len = 0;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            len = ctrl[i] >= 0 ? len + 1 : 0;
+            if (len > maxLen) maxLen = len;
+        }
+        return maxLen;
+    }
+
+    // Mean number of groups a stored key lies past its home group, which is
+    // the extra work a successful lookup does here
+    double averageDisplacement() const {
+        if (sz == 0) return 0.0;
+        size_t total = 0;
+        for (size_t i = 0; i < keys.size(); ++i)
+            if (ctrl[i] >= 0) total += displacement(i);
+        return static_cast<double>(total) / sz;
+    }
+
+    // Largest group displacement of a stored key
+    size_t maxDisplacement() const {
+        size_t maxDist = 0;
+        for (size_t i = 0; i < keys.size(); ++i)
+            if (ctrl[i] >= 0 && displacement(i) > maxDist)
+                maxDist = displacement(i);
+        return maxDist;
+    }
+
+    // Estimated memory usage in bytes
+    size_t memoryUsage() const {
+        return keys.size() * (sizeof(int) + sizeof(int8_t));
+    }
+
+    // Clear the table
+    void clear() {
+        std::fill(ctrl.begin(), ctrl.end(), ControlGroup::Empty);
+        sz = 0;
+        tombstones = 0;
+    }
+
+private:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    static size_t roundCapacity(size_t n) {
+        return Capacity::roundUp(std::max(n, ControlGroup::width));
+    }
+
+    void allocate(size_t capacity) {
+        keys.assign(capacity, 0);
+        ctrl.assign(capacity, ControlGroup::Empty);
+        groupMask = capacity / ControlGroup::width - 1;
+        cap.resize(capacity);
+    }
+
+    // Home group and 7-bit tag of a key; the tag is the top 7 bits of the
+    // 64-bit Fibonacci product, always non-negative as an int8_t
+    void locate(int key, size_t& group, int8_t& tag) const {
+        const uint64_t fib = 11400714819323198485ull;
+        group = hashFunc(key, cap) / ControlGroup::width;
+        tag = static_cast<int8_t>(
+            (static_cast<uint64_t>(static_cast<uint32_t>(key)) * fib) >> 57);
+    }
+
+    size_t find(int key, size_t group, int8_t tag) const {
+        for (size_t probes = 0; probes <= groupMask; ++probes) {
+            size_t base = group * ControlGroup::width;
+            ControlGroup g(&ctrl[base]);
+            for (uint32_t m = g.match(tag); m != 0; m &= m - 1) {
+                size_t idx = base + lowestBit(m);
+                if (keys[idx] == key) return idx;
+            }
+            if (g.matchEmpty() != 0) break;
+            group = (group + 1) & groupMask;
+        }
+        return npos;
+    }
+
+    // First empty or deleted slot on the probe sequence starting at group
+    size_t firstFree(size_t group) const {
+        while (true) {
+            size_t base = group * ControlGroup::width;
+            uint32_t m = ControlGroup(&ctrl[base]).matchFree();
+            if (m != 0) return base + lowestBit(m);
+            group = (group + 1) & groupMask;
+        }
+    }
+
+    size_t displacement(size_t idx) const {
+        size_t group;
+        int8_t tag;
+        locate(keys[idx], group, tag);
+        size_t at = idx / ControlGroup::width;
+        return (at - group) & groupMask;
+    }
+
+    void rehash(size_t newCapacity) {
+        std::vector<int> oldKeys = std::move(keys);
+        std::vector<int8_t> oldCtrl = std::move(ctrl);
+        allocate(newCapacity);
+        tombstones = 0;
+        for (size_t i = 0; i < oldKeys.size(); ++i) {
+            if (oldCtrl[i] < 0) continue;
+            size_t group;
+            int8_t tag;
+            locate(oldKeys[i], group, tag);
+            size_t idx = firstFree(group);
+            keys[idx] = oldKeys[i];
+            ctrl[idx] = tag;
+        }
+    }
+
+    std::vector<int> keys;
+    std::vector<int8_t> ctrl;
+    size_t sz;
+    size_t tombstones;
+    size_t groupMask = 0;
+    Capacity cap;
+    Hash hashFunc;
+};
+
+} // namespace fibhash
+
+#endif // FIBHASH_SWISS_HASH_TABLE_HPP
@@ -4,235 +4,1192 @@
 #include <random>
 #include <cmath>
 #include <cstdint>
+#include <cstdlib>
 #include <string>
-#include <functional>
 #include <fstream>
 #include <sstream>
 #include <iomanip>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
 
-// Check if a number is prime
-static bool isPrime(size_t n) {
-    if (n < 2) return false;
-    for (size_t i = 2; i * i <= n; ++i) {
-        if (n % i == 0) return false;
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#if defined(__linux__)
+#define FIBHASH_HAVE_PERF 1
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "fibhash/fibhash.hpp"
+
+using namespace fibhash;
+
+// Repetitions of every benchmark phase. Warm-up runs execute the whole
+// workload unrecorded, so caches, the allocator and the branch predictors
+// have settled before the first measured run.
+struct BenchConfig {
+    size_t warmupRuns = 1;
+    size_t runs = 5;
+    bool perfCounters = false; // count hardware events with perf_event_open
+    // Percentages of lookups, inserts and erases in the mixed phase
+    unsigned readPercent = 80;
+    unsigned writePercent = 15;
+    unsigned erasePercent = 5;
+    // Table and hash names to run and thread counts of the multi-threaded
+    // pass; an empty list selects every one
+    std::vector<std::string> tables;
+    std::vector<std::string> hashes;
+    std::vector<size_t> threadCounts;
+};
+
+// One operation of the mixed phase, on the key at index of the dataset
+struct MixedOp {
+    enum Kind : uint8_t { Read, Write, Erase };
+    Kind kind;
+    uint32_t index;
+};
+
+// As many operations as there are keys, each on a uniformly chosen key of
+// the dataset, in the proportions of config. Skew in the dataset, such as
+// the repeated keys of a Zipfian one, carries over to the operations.
+std::vector<MixedOp> mixedOps(size_t keyCount, const BenchConfig& config) {
+    std::vector<MixedOp> ops(keyCount);
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<uint32_t> index(
+        0, static_cast<uint32_t>(keyCount - 1));
+    std::uniform_int_distribution<unsigned> percent(
+        0, config.readPercent + config.writePercent + config.erasePercent - 1);
+    for (MixedOp& op : ops) {
+        unsigned p = percent(rng);
+        op.kind = p < config.readPercent ? MixedOp::Read
+                  : p < config.readPercent + config.writePercent
+                      ? MixedOp::Write
+                      : MixedOp::Erase;
+        op.index = index(rng);
     }
-    return true;
+    return ops;
 }
 
-// Return the next prime number >= n
-static size_t nextPrime(size_t n) {
-    while (!isPrime(n)) ++n;
-    return n;
+// Force value to be computed, so a loop whose results are otherwise unused
+// cannot be optimised away
+template <typename T>
+inline void doNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    volatile T sink = value;
+    (void)sink;
+#endif
 }
 
-// Simple open addressing hash table for integer keys using linear probing
-class HashTable {
-public:
-    using HashFunc = std::function<size_t(int, size_t)>;
+// Hardware events counted around the insert, find and erase phases
+enum PerfEvent {
+    Cycles,
+    Instructions,
+    L1dMisses,
+    LlcMisses,
+    BranchMisses,
+    DtlbMisses,
+    perfEventCount
+};
 
-    // Construct table with given capacity and hashing function
-    HashTable(size_t capacity, HashFunc func)
-        : keys(capacity), states(capacity, State::Empty), sz(0), hashFunc(func) {}
+constexpr const char* perfEventNames[perfEventCount] = {
+    "Cycles", "Instructions", "L1DMisses",
+    "LLCMisses", "BranchMisses", "DTLBMisses"};
 
-    // Remove all entries
-    ~HashTable() { clear(); }
+// Event totals of one phase summed over the measured runs. An event the
+// machine could not count stays invalid and is left blank in the CSV.
+struct PerfCounts {
+    double events[perfEventCount] = {};
+    bool valid[perfEventCount] = {};
+    size_t ops = 0;
 
-    // Insert a key using linear probing with automatic resizing
-    void insert(int key) {
-        insertInternal(key);
-        if (loadFactor() > 0.7) {
-            rehash(nextPrime(keys.size() * 2));
-        }
+    bool any() const {
+        for (bool v : valid)
+            if (v) return true;
+        return false;
     }
 
-    // Check if key is present
-    bool contains(int key) const {
-        size_t idx = hashFunc(key, keys.size());
-        size_t start = idx;
-        while (states[idx] != State::Empty) {
-            if (states[idx] == State::Filled && keys[idx] == key)
-                return true;
-            idx = (idx + 1) % keys.size();
-            if (idx == start) break;
+    double perOp(int event) const { return ops ? events[event] / ops : 0.0; }
+};
+
+// perf_event_open counters for the calling thread, user space only. Every
+// event is opened on its own, so a kernel or VM that lacks one still reports
+// the rest, and counts are scaled up if the kernel had to multiplex them.
+// Disabled, and on platforms without perf events, nothing is opened and
+// every count stays invalid.
+class PerfCounters {
+public:
+    explicit PerfCounters(bool enabled) {
+        for (int& fd : fds) fd = -1;
+#if defined(FIBHASH_HAVE_PERF)
+        if (!enabled) return;
+        const uint64_t cache = PERF_COUNT_HW_CACHE_OP_READ << 8 |
+                               PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+        const std::pair<uint32_t, uint64_t> config[perfEventCount] = {
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | cache},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+            {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | cache}};
+        for (int e = 0; e < perfEventCount; ++e) {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = config[e].first;
+            attr.config = config[e].second;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format =
+                PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fds[e] = static_cast<int>(
+                ::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
         }
-        return false;
+#else
+        (void)enabled;
+#endif
     }
 
-    // Remove a key if present
-    bool remove(int key) {
-        size_t idx = hashFunc(key, keys.size());
-        size_t start = idx;
-        while (states[idx] != State::Empty) {
-            if (states[idx] == State::Filled && keys[idx] == key) {
-                states[idx] = State::Deleted;
-                --sz;
-                return true;
-            }
-            idx = (idx + 1) % keys.size();
-            if (idx == start) break;
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    ~PerfCounters() {
+#if defined(FIBHASH_HAVE_PERF)
+        for (int fd : fds)
+            if (fd >= 0) ::close(fd);
+#endif
+    }
+
+    void start() {
+#if defined(FIBHASH_HAVE_PERF)
+        for (int fd : fds) {
+            if (fd < 0) continue;
+            ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
         }
-        return false;
+#endif
     }
 
-    // Current load factor
-    double loadFactor() const { return static_cast<double>(sz) / keys.size(); }
-
-    // Average cluster length (contiguous filled slots)
-    double averageChainLength() const {
-        size_t clusterCount = 0;
-        size_t total = 0;
-        for (size_t i = 0; i < keys.size();) {
-            if (states[i] == State::Filled) {
-                size_t len = 0;
-                while (i < keys.size() && states[i] == State::Filled) {
-                    ++len;
-                    ++i;
-                }
-                ++clusterCount;
-                total += len;
-            } else {
-                ++i;
-            }
+    // Stop counting and add what was counted over ops operations to totals
+    void stop(PerfCounts& totals, size_t ops) {
+        totals.ops += ops;
+#if defined(FIBHASH_HAVE_PERF)
+        for (int e = 0; e < perfEventCount; ++e) {
+            if (fds[e] < 0) continue;
+            ::ioctl(fds[e], PERF_EVENT_IOC_DISABLE, 0);
+            uint64_t value[3]; // count, time enabled, time running
+            if (::read(fds[e], value, sizeof(value)) != sizeof(value) ||
+                value[2] == 0)
+                continue;
+            totals.events[e] +=
+                static_cast<double>(value[0]) * value[1] / value[2];
+            totals.valid[e] = true;
         }
-        if (clusterCount == 0) return 0.0;
-        return static_cast<double>(total) / clusterCount;
-    }
-
-    // Maximum cluster length
-    size_t maxChainLength() const {
-        size_t maxLen = 0;
-        for (size_t i = 0; i < keys.size();) {
-            if (states[i] == State::Filled) {
-                size_t len = 0;
-                while (i < keys.size() && states[i] == State::Filled) {
-                    ++len;
-                    ++i;
-                }
-                if (len > maxLen) maxLen = len;
-            } else {
-                ++i;
-            }
+#else
+        (void)totals;
+#endif
+    }
+
+private:
+    int fds[perfEventCount];
+};
+
+// Timestamp counter for timing single operations: rdtsc on x86, the virtual
+// counter on aarch64 and steady_clock nanoseconds elsewhere. The fence keeps
+// the read from moving ahead of the operation being timed.
+static inline uint64_t readTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_lfence();
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    asm volatile("isb\n\tmrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+#endif
+}
+
+// Ticks of readTicks per nanosecond, measured once against steady_clock
+double ticksPerNs() {
+    static const double rate = [] {
+        auto start = std::chrono::steady_clock::now();
+        uint64_t first = readTicks();
+        while (std::chrono::steady_clock::now() - start <
+               std::chrono::milliseconds(20)) {
         }
-        return maxLen;
+        uint64_t last = readTicks();
+        double ns = std::chrono::duration<double, std::nano>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+        return (last - first) / ns;
+    }();
+    return rate;
+}
+
+// Tail latencies of one phase, in ns
+struct LatencyStats {
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p99 = 0.0;
+    double p999 = 0.0;
+    double max = 0.0;
+};
+
+// Log-bucketed histogram in the style of HdrHistogram. Values below
+// 2 * subBuckets are counted exactly; above that every power of two is split
+// into subBuckets linear steps, so a recorded value is off by at most
+// 1 / subBuckets while the whole 64-bit range fits in a couple of thousand
+// counters.
+class LatencyHistogram {
+public:
+    static constexpr unsigned subBucketBits = 5;
+    static constexpr size_t subBuckets = size_t(1) << subBucketBits;
+
+    LatencyHistogram() : counts(subBuckets * (64 - subBucketBits) + subBuckets) {}
+
+    void record(uint64_t value) {
+        ++counts[indexOf(value)];
+        ++total;
+        maxValue = std::max(maxValue, value);
     }
 
-    // Estimated memory usage in bytes
-    size_t memoryUsage() const {
-        return keys.size() * (sizeof(int) + sizeof(State));
+    // Largest value of the bucket holding the q-th quantile
+    uint64_t quantile(double q) const {
+        if (total == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(std::ceil(q * total));
+        if (rank == 0) rank = 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); ++i) {
+            seen += counts[i];
+            if (seen >= rank) return std::min(highestIn(i), maxValue);
+        }
+        return maxValue;
     }
 
-    // Clear the table
-    void clear() {
-        std::fill(states.begin(), states.end(), State::Empty);
-        sz = 0;
+    // Percentiles converted from ticks to ns
+    LatencyStats summary() const {
+        const double scale = 1.0 / ticksPerNs();
+        return {quantile(0.50) * scale, quantile(0.90) * scale,
+                quantile(0.99) * scale, quantile(0.999) * scale,
+                maxValue * scale};
     }
 
 private:
-    void insertInternal(int key) {
-        size_t idx = hashFunc(key, keys.size());
-        while (states[idx] == State::Filled) {
-            if (keys[idx] == key)
-                return; // already in table
-            idx = (idx + 1) % keys.size();
-        }
-        keys[idx] = key;
-        states[idx] = State::Filled;
-        ++sz;
+    static size_t indexOf(uint64_t value) {
+        unsigned msb = value ? 63 - static_cast<unsigned>(__builtin_clzll(value)) : 0;
+        unsigned shift = msb > subBucketBits ? msb - subBucketBits : 0;
+        return subBuckets * shift + static_cast<size_t>(value >> shift);
     }
 
-    void rehash(size_t newCapacity) {
-        std::vector<int> oldKeys = keys;
-        std::vector<State> oldStates = states;
-        keys.assign(newCapacity, 0);
-        states.assign(newCapacity, State::Empty);
-        sz = 0;
-        for (size_t i = 0; i < oldKeys.size(); ++i) {
-            if (oldStates[i] == State::Filled)
-                insertInternal(oldKeys[i]);
-        }
+    static uint64_t highestIn(size_t index) {
+        if (index < 2 * subBuckets) return index;
+        unsigned shift = static_cast<unsigned>(index / subBuckets - 1);
+        uint64_t mantissa = index - subBuckets * shift;
+        return ((mantissa + 1) << shift) - 1;
     }
 
-    enum class State { Empty, Filled, Deleted };
-    std::vector<int> keys;
-    std::vector<State> states;
-    size_t sz;
-    HashFunc hashFunc;
+    std::vector<uint64_t> counts;
+    uint64_t total = 0;
+    uint64_t maxValue = 0;
+};
+
+// Median, standard deviation and minimum of a phase over the measured runs
+struct OpStats {
+    double median = 0.0;
+    double stddev = 0.0;
+    double min = 0.0;
 };
 
-// Fibonacci hashing for integers
-static size_t fibonacciHash(int key, size_t tableSize) {
-    static const uint32_t fib = 2654435769u; // 2^32 / golden ratio
-    return (static_cast<uint64_t>(static_cast<uint32_t>(key) * fib)) % tableSize;
+// Statistics of samples, each multiplied by scale first
+OpStats summarize(std::vector<double> samples, double scale = 1.0) {
+    OpStats s;
+    if (samples.empty()) return s;
+    for (double& x : samples) x *= scale;
+    std::sort(samples.begin(), samples.end());
+    size_t n = samples.size();
+    s.median = n % 2 ? samples[n / 2]
+                     : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+    s.min = samples.front();
+    if (n > 1) {
+        double mean = 0.0;
+        for (double x : samples) mean += x;
+        mean /= n;
+        double var = 0.0;
+        for (double x : samples) var += (x - mean) * (x - mean);
+        s.stddev = std::sqrt(var / (n - 1));
+    }
+    return s;
+}
+
+// Wall time of fn applied to every key, in µs
+template <typename Key, typename Fn>
+double timeOps(const std::vector<Key>& keys, Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (const Key& k : keys) fn(k);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count();
 }
 
-// Simple modulo hashing
-static size_t moduloHash(int key, size_t tableSize) {
-    return static_cast<uint32_t>(key) % tableSize;
+// As many keys as given that no dataset contains, for miss lookups.
+// Datasets hold non-negative ints, so the absent keys are negative.
+std::vector<int> absentKeys(const std::vector<int>& keys) {
+    std::vector<int> absent(keys.size());
+    std::mt19937 rng(7);
+    for (int& k : absent) k = -1 - static_cast<int>(rng() >> 1);
+    return absent;
+}
+
+std::vector<std::string> absentKeys(const std::vector<std::string>& keys) {
+    std::vector<std::string> absent;
+    absent.reserve(keys.size());
+    std::mt19937 rng(7);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        int k = -1 - static_cast<int>(rng() >> 1);
+        absent.push_back("key:" + std::to_string(k));
+    }
+    return absent;
+}
+
+// Keys without repeats, in order of first appearance
+std::vector<int> distinctKeys(const std::vector<int>& keys) {
+    HashTable<FibonacciHash> seen(keys.size());
+    std::vector<int> distinct;
+    distinct.reserve(keys.size());
+    for (int k : keys) {
+        if (seen.contains(k)) continue;
+        seen.insert(k);
+        distinct.push_back(k);
+    }
+    return distinct;
 }
 
 struct Metrics {
     double loadFactor;
     double avgChain;
     size_t maxChain;
+    double avgProbe;
+    size_t maxProbe;
     double insertTime;
     double findTime;
     double eraseTime;
+    double maxInsertTime;
+    double batchFindTime; // 0 for tables without contains_batch
+    double buildTime;     // 0 for tables without build
     size_t memory;
+    double bitsPerKey;
+    double falsePositiveRate; // 0 for exact tables
+    double smallTablesTime;   // 0 for filters
+    size_t tombstones;        // left after the first mixed phase
+    size_t cleanups;          // in-place cleanups during the first run
+    OpStats insertNs;         // per-operation costs in ns
+    OpStats findHitNs;
+    OpStats findMissNs;
+    OpStats eraseNs;
+    OpStats mixedNs; // per operation of the interleaved phase
+    PerfCounts insertPerf;    // hardware events, if counted
+    PerfCounts findPerf;      // of the hit lookups
+    PerfCounts erasePerf;
+    LatencyStats insertLatency; // per-operation tails, in ns
+    LatencyStats findLatency;   // of the hit lookups
+    LatencyStats eraseLatency;
+    ProbeStats probes; // of the latency run, if the table counts them
 };
 
+// Time every insert, hit lookup and erase of one extra run on its own. Rare
+// slow operations such as a synchronous rehash only show up like this: a
+// sample of every Nth operation would usually miss them.
+template <typename Table, typename Key>
+void measureLatency(Table& table, const std::vector<Key>& keys, Metrics& m) {
+    LatencyHistogram insert, find, erase;
+    for (const Key& k : keys) {
+        uint64_t start = readTicks();
+        table.insert(k);
+        insert.record(readTicks() - start);
+    }
+    for (const Key& k : keys) {
+        uint64_t start = readTicks();
+        doNotOptimize(table.contains(k));
+        find.record(readTicks() - start);
+    }
+    for (const Key& k : keys) {
+        uint64_t start = readTicks();
+        doNotOptimize(table.remove(k));
+        erase.record(readTicks() - start);
+    }
+    m.insertLatency = insert.summary();
+    m.findLatency = find.summary();
+    m.eraseLatency = erase.summary();
+    m.maxInsertTime = m.insertLatency.max / 1000.0;
+}
+
+// Throughput of each phase in millions of operations per second
+struct ConcurrentMetrics {
+    double insertMops;
+    double findMops;
+    double mixedMops; // 95% contains, 5% insert/remove
+    double eraseMops;
+    // Lookups by threads pinned to each node, in the replica of their own
+    // node and in that of the next node; 0 for unreplicated tables
+    double localFindMops;
+    double remoteFindMops;
+};
+
+// Labels identifying a benchmarked table configuration
+struct Variant {
+    std::string table;
+    std::string method;
+    std::string capacity;
+    std::string erase;
+    std::string allocator;
+};
+
+// Allocator name of a table; tables without an allocator parameter use the
+// standard one
+template <typename Table, typename = void>
+struct TableAllocatorName {
+    static constexpr const char* value = "Std";
+};
+
+template <typename Table>
+struct TableAllocatorName<Table, std::void_t<decltype(Table::allocator_name)>> {
+    static constexpr const char* value = Table::allocator_name;
+};
+
+template <typename Table>
+Variant variantOf() {
+    return {Table::name, Table::hasher::name, Table::capacity_type::name,
+            Table::erase_name, TableAllocatorName<Table>::value};
+}
+
+// Whether name is in list; an empty list holds every name
+bool listed(const std::vector<std::string>& list, const std::string& name) {
+    return list.empty() || std::find(list.begin(), list.end(), name) != list.end();
+}
+
+// Whether a --tables item names v. The item holds up to four fields
+// separated by '/', table/capacity/erase/allocator as in the CSV columns,
+// and a field left out matches every value: "Linear" is each Linear
+// variant, "Linear/Prime/BackwardShift" only one of them.
+bool namesVariant(const std::string& item, const Variant& v) {
+    const std::string* fields[] = {&v.table, &v.capacity, &v.erase,
+                                   &v.allocator};
+    std::istringstream in(item);
+    std::string field;
+    for (const std::string* expected : fields) {
+        if (!std::getline(in, field, '/')) return true;
+        if (field != *expected) return false;
+    }
+    return !std::getline(in, field, '/');
+}
+
+// Whether config asks for the variant and hash of v
+bool selected(const BenchConfig& config, const Variant& v) {
+    return (config.tables.empty() ||
+            std::any_of(config.tables.begin(), config.tables.end(),
+                        [&](const std::string& item) {
+                            return namesVariant(item, v);
+                        })) &&
+           listed(config.hashes, v.method);
+}
+
 // Write a CSV row with metrics
 void writeCsv(std::ofstream& out, size_t numKeys, const std::string& dataset,
-              const std::string& method, const Metrics& m) {
-    out << numKeys << ',' << dataset << ',' << method << ',' << m.loadFactor
-        << ',' << m.avgChain << ',' << m.maxChain << ',' << m.insertTime << ','
-        << m.findTime << ',' << m.eraseTime << ',' << m.memory << '\n';
+              const Variant& v, const Metrics& m) {
+    out << numKeys << ',' << dataset << ',' << v.table << ',' << v.method << ','
+        << v.capacity << ',' << v.erase << ',' << v.allocator << ','
+        << m.loadFactor << ','
+        << m.avgChain << ',' << m.maxChain << ',' << m.avgProbe << ','
+        << m.maxProbe << ',' << m.insertTime << ',' << m.findTime << ','
+        << m.eraseTime << ',' << m.maxInsertTime << ',' << m.batchFindTime
+        << ',' << m.buildTime << ',' << m.memory << ',' << m.bitsPerKey << ','
+        << std::setprecision(6) << m.falsePositiveRate << std::setprecision(2)
+        << ',' << m.smallTablesTime << ',' << m.tombstones << ','
+        << m.cleanups;
+    for (const OpStats* s : {&m.insertNs, &m.findHitNs, &m.findMissNs,
+                             &m.eraseNs, &m.mixedNs})
+        out << ',' << s->median << ',' << s->stddev << ',' << s->min;
+    for (const LatencyStats* l :
+         {&m.insertLatency, &m.findLatency, &m.eraseLatency})
+        out << ',' << l->p50 << ',' << l->p90 << ',' << l->p99 << ','
+            << l->p999 << ',' << l->max;
+    for (const PerfCounts* p : {&m.insertPerf, &m.findPerf, &m.erasePerf}) {
+        for (int e = 0; e < perfEventCount; ++e) {
+            out << ',';
+            if (p->valid[e]) out << p->perOp(e);
+        }
+    }
+    out << '\n';
 }
 
-// Benchmark the table using the provided keys
-Metrics runTest(const std::vector<int>& keys, HashTable::HashFunc func,
-                size_t initialSize, size_t runs = 3) {
-    double totalInsert = 0.0;
-    double totalFind = 0.0;
-    double totalErase = 0.0;
+// s as a JSON string literal
+std::string jsonString(const std::string& s) {
+    static const char hex[] = "0123456789abcdef";
+    std::string out = "\"";
+    for (char c : s) {
+        unsigned char u = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (u < 0x20) {
+            out += "\\u00";
+            out += hex[u >> 4];
+            out += hex[u & 15];
+        } else {
+            out += c;
+        }
+    }
+    return out + '"';
+}
 
-    double loadFactor = 0.0;
-    double avgChain = 0.0;
-    size_t maxChain = 0;
-    size_t mem = 0;
+// Writes one JSON object field by field, adding the separating commas.
+// field(name) starts a nested value: write it to the returned stream, for
+// example with another JsonObject, before the next field.
+class JsonObject {
+public:
+    explicit JsonObject(std::ostream& out) : out(out) { out << '{'; }
+    ~JsonObject() { out << '}'; }
 
-    for (size_t i = 0; i < runs; ++i) {
-        HashTable table(initialSize, func);
+    std::ostream& field(const char* name) {
+        out << (first ? "" : ",") << jsonString(name) << ':';
+        first = false;
+        return out;
+    }
 
-        auto start = std::chrono::high_resolution_clock::now();
-        for (int k : keys) table.insert(k);
-        auto end = std::chrono::high_resolution_clock::now();
-        totalInsert +=
-            std::chrono::duration<double, std::micro>(end - start).count();
+    JsonObject& field(const char* name, const std::string& value) {
+        field(name) << jsonString(value);
+        return *this;
+    }
+
+    // JSON has no NaN or infinity, so those become null
+    JsonObject& field(const char* name, double value) {
+        if (std::isfinite(value))
+            field(name) << value;
+        else
+            field(name) << "null";
+        return *this;
+    }
+
+private:
+    std::ostream& out;
+    bool first = true;
+};
+
+// Write metrics as one JSON object, with the same values as the CSV row
+void writeJson(std::ostream& out, size_t numKeys, const std::string& dataset,
+               const Variant& v, const Metrics& m) {
+    JsonObject row(out);
+    row.field("numKeys", static_cast<double>(numKeys))
+        .field("dataset", dataset)
+        .field("table", v.table)
+        .field("method", v.method)
+        .field("capacity", v.capacity)
+        .field("erase", v.erase)
+        .field("allocator", v.allocator)
+        .field("loadFactor", m.loadFactor)
+        .field("averageCluster", m.avgChain)
+        .field("maxCluster", static_cast<double>(m.maxChain))
+        .field("averageProbe", m.avgProbe)
+        .field("maxProbe", static_cast<double>(m.maxProbe))
+        .field("insertTimeUs", m.insertTime)
+        .field("findTimeUs", m.findTime)
+        .field("eraseTimeUs", m.eraseTime)
+        .field("maxInsertTimeUs", m.maxInsertTime)
+        .field("batchFindTimeUs", m.batchFindTime)
+        .field("buildTimeUs", m.buildTime)
+        .field("memoryBytes", static_cast<double>(m.memory))
+        .field("bitsPerKey", m.bitsPerKey)
+        .field("falsePositiveRate", m.falsePositiveRate)
+        .field("smallTablesTimeUs", m.smallTablesTime)
+        .field("tombstones", static_cast<double>(m.tombstones))
+        .field("cleanups", static_cast<double>(m.cleanups));
+    const std::pair<const char*, const OpStats*> ops[] = {
+        {"insertNs", &m.insertNs},   {"findHitNs", &m.findHitNs},
+        {"findMissNs", &m.findMissNs}, {"eraseNs", &m.eraseNs},
+        {"mixedNs", &m.mixedNs}};
+    for (const auto& [name, s] : ops)
+        JsonObject(row.field(name))
+            .field("median", s->median)
+            .field("stddev", s->stddev)
+            .field("min", s->min);
+    const std::pair<const char*, const LatencyStats*> latencies[] = {
+        {"insertLatencyNs", &m.insertLatency},
+        {"findLatencyNs", &m.findLatency},
+        {"eraseLatencyNs", &m.eraseLatency}};
+    for (const auto& [name, l] : latencies)
+        JsonObject(row.field(name))
+            .field("p50", l->p50)
+            .field("p90", l->p90)
+            .field("p99", l->p99)
+            .field("p999", l->p999)
+            .field("max", l->max);
+    const std::pair<const char*, const PerfCounts*> perf[] = {
+        {"insertEventsPerOp", &m.insertPerf},
+        {"findEventsPerOp", &m.findPerf},
+        {"eraseEventsPerOp", &m.erasePerf}};
+    for (const auto& [name, p] : perf) {
+        JsonObject events(row.field(name));
+        for (int e = 0; e < perfEventCount; ++e)
+            if (p->valid[e]) events.field(perfEventNames[e], p->perOp(e));
+    }
+}
+
+// Write a CSV row with multi-threaded throughput
+void writeConcurrentCsv(std::ofstream& out, size_t numKeys,
+                        const std::string& dataset, const std::string& table,
+                        size_t threads, const ConcurrentMetrics& m) {
+    out << numKeys << ',' << dataset << ',' << table << ',' << threads << ','
+        << m.insertMops << ',' << m.findMops << ',' << m.mixedMops << ','
+        << m.eraseMops << ',' << m.localFindMops << ',' << m.remoteFindMops
+        << '\n';
+}
+
+// Write multi-threaded throughput as one JSON object
+void writeConcurrentJson(std::ostream& out, size_t numKeys,
+                         const std::string& dataset, const std::string& table,
+                         size_t threads, const ConcurrentMetrics& m) {
+    JsonObject(out)
+        .field("numKeys", static_cast<double>(numKeys))
+        .field("dataset", dataset)
+        .field("table", table)
+        .field("threads", static_cast<double>(threads))
+        .field("insertMops", m.insertMops)
+        .field("findMops", m.findMops)
+        .field("mixedMops", m.mixedMops)
+        .field("eraseMops", m.eraseMops)
+        .field("localFindMops", m.localFindMops)
+        .field("remoteFindMops", m.remoteFindMops);
+}
+
+// Destination of all results: the single- and multi-threaded CSV files
+// and, if a path is given, one JSON document holding both as arrays under
+// "results" and "concurrent". The JSON is written when the writer closes.
+class ResultWriter {
+public:
+    ResultWriter() = default;
+    ResultWriter(const ResultWriter&) = delete;
+    ResultWriter& operator=(const ResultWriter&) = delete;
+    ~ResultWriter() { close(); }
+
+    // Open the outputs and write the CSV headers. On failure, error names
+    // the file that could not be opened.
+    bool open(const std::string& csvPath, const std::string& mtCsvPath,
+              const std::string& jsonFile, std::string& error) {
+        csv.open(csvPath);
+        if (!csv) {
+            error = csvPath;
+            return false;
+        }
+        csv << std::fixed << std::setprecision(2);
+        csv << "NumKeys,Dataset,Table,Method,Capacity,Erase,Allocator,LoadFactor,";
+        csv << "AverageCluster,MaxCluster,AverageProbe,MaxProbe,";
+        csv << "InsertTime(us),FindTime(us),EraseTime(us),MaxInsertTime(us),";
+        csv << "BatchFindTime(us),BuildTime(us),Memory(B),BitsPerKey,";
+        csv << "FalsePositiveRate,SmallTablesTime(us),Tombstones,Cleanups,";
+        csv << "InsertNs,InsertNsStdDev,InsertNsMin,";
+        csv << "FindHitNs,FindHitNsStdDev,FindHitNsMin,";
+        csv << "FindMissNs,FindMissNsStdDev,FindMissNsMin,";
+        csv << "EraseNs,EraseNsStdDev,EraseNsMin,";
+        csv << "MixedNs,MixedNsStdDev,MixedNsMin";
+        for (const char* phase : {"Insert", "Find", "Erase"})
+            for (const char* q : {"P50", "P90", "P99", "P999", "Max"})
+                csv << ',' << phase << q << "(ns)";
+        for (const char* phase : {"Insert", "Find", "Erase"})
+            for (const char* event : perfEventNames)
+                csv << ',' << phase << event << "/op";
+        csv << '\n';
+
+        mtCsv.open(mtCsvPath);
+        if (!mtCsv) {
+            error = mtCsvPath;
+            return false;
+        }
+        mtCsv << std::fixed << std::setprecision(2);
+        mtCsv << "NumKeys,Dataset,Table,Threads,Insert(Mops),Find(Mops),";
+        mtCsv << "Mixed(Mops),Erase(Mops),LocalFind(Mops),RemoteFind(Mops)\n";
+
+        jsonPath = jsonFile;
+        results.precision(10);
+        concurrent.precision(10);
+        return true;
+    }
+
+    void write(size_t numKeys, const std::string& dataset, const Variant& v,
+               const Metrics& m) {
+        writeCsv(csv, numKeys, dataset, v, m);
+        if (jsonPath.empty()) return;
+        results << (results.tellp() > 0 ? ",\n  " : "  ");
+        writeJson(results, numKeys, dataset, v, m);
+    }
+
+    void writeConcurrent(size_t numKeys, const std::string& dataset,
+                         const std::string& table, size_t threads,
+                         const ConcurrentMetrics& m) {
+        writeConcurrentCsv(mtCsv, numKeys, dataset, table, threads, m);
+        if (jsonPath.empty()) return;
+        concurrent << (concurrent.tellp() > 0 ? ",\n  " : "  ");
+        writeConcurrentJson(concurrent, numKeys, dataset, table, threads, m);
+    }
+
+    // Flush the CSV files and write the JSON document. Returns false if any
+    // output failed.
+    bool close() {
+        bool ok = true;
+        if (csv.is_open()) {
+            csv.close();
+            ok = ok && csv;
+            mtCsv.close();
+            ok = ok && mtCsv;
+        }
+        if (!jsonPath.empty()) {
+            std::ofstream json(jsonPath);
+            json << "{\"results\": [\n" << results.str()
+                 << "\n],\n\"concurrent\": [\n" << concurrent.str() << "\n]}\n";
+            ok = ok && json;
+            jsonPath.clear();
+        }
+        return ok;
+    }
+
+private:
+    std::ofstream csv;
+    std::ofstream mtCsv;
+    std::string jsonPath;
+    std::ostringstream results;
+    std::ostringstream concurrent;
+};
+
+// Detects tables offering the batched lookup API
+template <typename Table, typename = void>
+struct HasBatchLookup : std::false_type {};
+
+template <typename Table>
+struct HasBatchLookup<
+    Table, std::void_t<decltype(std::declval<const Table&>().contains_batch(
+               nullptr, 0, nullptr))>> : std::true_type {};
+
+// Time contains_batch over keys in chunks the size our callers hand us
+template <typename Table, typename Key>
+double timeBatchFind(const Table& table, const std::vector<Key>& keys) {
+    if constexpr (HasBatchLookup<Table>::value) {
+        const size_t chunk = 4096;
+        std::vector<uint8_t> found(chunk);
+        size_t hits = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < keys.size(); i += chunk) {
+            size_t n = std::min(chunk, keys.size() - i);
+            table.contains_batch(keys.data() + i, n, found.data());
+            for (size_t j = 0; j < n; ++j) hits += found[j];
+        }
+        auto end = std::chrono::steady_clock::now();
+        doNotOptimize(hits);
+        return std::chrono::duration<double, std::micro>(end - start).count();
+    } else {
+        (void)table;
+        (void)keys;
+        return 0.0;
+    }
+}
+
+// Detects tables offering a parallel bulk build
+template <typename Table, typename = void>
+struct HasBulkBuild : std::false_type {};
+
+template <typename Table>
+struct HasBulkBuild<Table, std::void_t<decltype(std::declval<Table&>().build(
+                               std::declval<const std::vector<int>&>(), 1))>>
+    : std::true_type {};
+
+// Time building a fresh table from keys with every hardware thread
+template <typename Table, typename Key>
+double timeBuild(const std::vector<Key>& keys, size_t initialSize,
+                 const typename Table::hasher& hash) {
+    if constexpr (HasBulkBuild<Table>::value) {
+        size_t threads = std::max(1u, std::thread::hardware_concurrency());
+        Table table(initialSize, hash);
+        auto start = std::chrono::steady_clock::now();
+        table.build(keys, threads);
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::micro>(end - start).count();
+    } else {
+        (void)keys;
+        (void)initialSize;
+        (void)hash;
+        return 0.0;
+    }
+}
+
+// Keys per table in the small-table pass; most tables in a request hold
+// fewer than 16 keys
+constexpr size_t smallTableKeys = 12;
+
+// Time the per-request pattern: for every smallTableKeys keys, construct a
+// table, insert them, look them up and destroy it again
+template <typename Table, typename Key>
+double timeSmallTables(const std::vector<Key>& keys, size_t initialSize,
+                       const typename Table::hasher& hash) {
+    size_t hits = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < keys.size(); i += smallTableKeys) {
+        size_t end = std::min(keys.size(), i + smallTableKeys);
+        Table table(initialSize, hash);
+        for (size_t j = i; j < end; ++j) table.insert(keys[j]);
+        for (size_t j = i; j < end; ++j) hits += table.contains(keys[j]);
+    }
+    auto end = std::chrono::steady_clock::now();
+    doNotOptimize(hits);
+    return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+// Refill table with keys, then time the interleaved operations on it, in µs
+template <typename Table, typename Key>
+double timeMixed(Table& table, const std::vector<Key>& keys,
+                 const std::vector<MixedOp>& ops) {
+    for (const Key& k : keys) table.insert(k);
+    return timeOps(ops, [&](const MixedOp& op) {
+        const Key& k = keys[op.index];
+        switch (op.kind) {
+        case MixedOp::Read: doNotOptimize(table.contains(k)); break;
+        case MixedOp::Write: table.insert(k); break;
+        case MixedOp::Erase: doNotOptimize(table.remove(k)); break;
+        }
+    });
+}
+
+// Tables built with counters for the probes of every operation
+template <typename Table, typename = void>
+struct HasProbeStats : std::false_type {};
+
+template <typename Table>
+struct HasProbeStats<Table, std::void_t<decltype(Table::probe_stats)>>
+    : std::bool_constant<Table::probe_stats> {};
+
+// Tables that count tombstones and their in-place cleanups
+template <typename Table, typename = void>
+struct HasTombstoneCleanup : std::false_type {};
+
+template <typename Table>
+struct HasTombstoneCleanup<
+    Table, std::void_t<decltype(std::declval<const Table&>().cleanups())>>
+    : std::true_type {};
+
+// Tables that queue writes until flush()
+template <typename Table, typename = void>
+struct HasFlush : std::false_type {};
+
+template <typename Table>
+struct HasFlush<Table, std::void_t<decltype(std::declval<Table&>().flush())>>
+    : std::true_type {};
+
+// Tables with one replica per NUMA node
+template <typename Table, typename = void>
+struct HasReplicas : std::false_type {};
+
+template <typename Table>
+struct HasReplicas<
+    Table, std::void_t<decltype(std::declval<const Table&>().replicaCount())>>
+    : std::true_type {};
+
+// Detects tables drawing their memory from a std::pmr resource
+template <typename Table, typename = void>
+struct UsesMemoryResource : std::false_type {};
+
+template <typename Table>
+struct UsesMemoryResource<Table, std::void_t<typename Table::allocator_type>>
+    : std::is_same<typename Table::allocator_type,
+                   std::pmr::polymorphic_allocator<int>> {};
+
+// For pmr tables, a monotonic arena installed as the default resource for
+// one benchmark run. Every table of the run is carved out of it and the
+// whole arena is released at once, as with a per-request arena.
+template <typename Table, bool = UsesMemoryResource<Table>::value>
+struct RunArena {};
+
+template <typename Table>
+struct RunArena<Table, true> {
+    std::pmr::monotonic_buffer_resource arena;
+    std::pmr::memory_resource* previous = std::pmr::set_default_resource(&arena);
+
+    ~RunArena() { std::pmr::set_default_resource(previous); }
+};
+
+// Benchmark the table using the provided keys. Every run inserts the keys,
+// looks each of them up (hits), looks up as many absent keys (misses) and
+// erases the keys again. Times are the median over config.runs measured
+// runs, after config.warmupRuns unrecorded ones.
+template <typename Table, typename Key>
+Metrics runTest(const std::vector<Key>& keys, size_t initialSize,
+                typename Table::hasher hash = {},
+                const BenchConfig& config = {}) {
+    const std::vector<Key> misses = absentKeys(keys);
+    const std::vector<MixedOp> ops = mixedOps(keys.size(), config);
+    std::vector<double> insertUs, hitUs, missUs, eraseUs, mixedUs;
+    std::vector<double> batchUs, buildUs, smallUs;
+    Metrics m{};
+    size_t stored = 0;
+    PerfCounters perf(config.perfCounters);
+    PerfCounts scratch; // counts of the warm-up runs, discarded
+
+    for (size_t i = 0; i < config.warmupRuns + config.runs; ++i) {
+        [[maybe_unused]] RunArena<Table> arena;
+        Table table(initialSize, hash);
+        bool measured = i >= config.warmupRuns;
+
+        perf.start();
+        double insert = timeOps(keys, [&](const Key& k) { table.insert(k); });
+        perf.stop(measured ? m.insertPerf : scratch, keys.size());
 
         if (i == 0) {
-            loadFactor = table.loadFactor();
-            avgChain = table.averageChainLength();
-            maxChain = table.maxChainLength();
-            mem = table.memoryUsage();
+            m.loadFactor = table.loadFactor();
+            m.avgChain = table.averageChainLength();
+            m.maxChain = table.maxChainLength();
+            m.avgProbe = table.averageDisplacement();
+            m.maxProbe = table.maxDisplacement();
+            m.memory = table.memoryUsage();
+            stored = table.size();
         }
 
-        start = std::chrono::high_resolution_clock::now();
-        for (int k : keys) table.contains(k);
-        end = std::chrono::high_resolution_clock::now();
-        totalFind +=
-            std::chrono::duration<double, std::micro>(end - start).count();
+        perf.start();
+        double hit = timeOps(
+            keys, [&](const Key& k) { doNotOptimize(table.contains(k)); });
+        perf.stop(measured ? m.findPerf : scratch, keys.size());
+        double miss = timeOps(
+            misses, [&](const Key& k) { doNotOptimize(table.contains(k)); });
+        double batch = timeBatchFind(table, keys);
+        perf.start();
+        double erase = timeOps(
+            keys, [&](const Key& k) { doNotOptimize(table.remove(k)); });
+        perf.stop(measured ? m.erasePerf : scratch, keys.size());
+        double mixed = timeMixed(table, keys, ops);
+        if constexpr (HasTombstoneCleanup<Table>::value) {
+            if (i == 0) {
+                m.tombstones = table.tombstones();
+                m.cleanups = table.cleanups();
+            }
+        }
+        double build = timeBuild<Table>(keys, initialSize, hash);
+        double small = timeSmallTables<Table>(keys, initialSize, hash);
+
+        if (!measured) continue;
+        insertUs.push_back(insert);
+        hitUs.push_back(hit);
+        missUs.push_back(miss);
+        eraseUs.push_back(erase);
+        mixedUs.push_back(mixed);
+        batchUs.push_back(batch);
+        buildUs.push_back(build);
+        smallUs.push_back(small);
+    }
+
+    {
+        [[maybe_unused]] RunArena<Table> arena;
+        Table table(initialSize, hash);
+        measureLatency(table, keys, m);
+        if constexpr (HasProbeStats<Table>::value) m.probes = table.probeStats();
+    }
 
-        start = std::chrono::high_resolution_clock::now();
-        for (int k : keys) table.remove(k);
-        end = std::chrono::high_resolution_clock::now();
-        totalErase +=
+    const double nsPerOp = 1000.0 / keys.size();
+    m.insertTime = summarize(insertUs).median;
+    m.findTime = summarize(hitUs).median;
+    m.eraseTime = summarize(eraseUs).median;
+    m.batchFindTime = summarize(batchUs).median;
+    m.buildTime = summarize(buildUs).median;
+    m.bitsPerKey = stored ? m.memory * 8.0 / stored : 0.0;
+    m.smallTablesTime = summarize(smallUs).median;
+    m.insertNs = summarize(insertUs, nsPerOp);
+    m.findHitNs = summarize(hitUs, nsPerOp);
+    m.findMissNs = summarize(missUs, nsPerOp);
+    m.eraseNs = summarize(eraseUs, nsPerOp);
+    m.mixedNs = summarize(mixedUs, nsPerOp);
+    return m;
+}
+
+// Benchmark an approximate membership filter sized for the keys, with the
+// same runs as runTest. Every hit among the absent keys is a false positive.
+// There is no mixed phase: erasing a key that was never inserted could
+// remove another key's fingerprint. The keys must be distinct, since a
+// bucket pair holds only so many copies of one fingerprint. Returns nothing
+// if an insert fails, as the filter is then full and its figures are void.
+template <typename Filter>
+std::optional<Metrics> runFilterTest(const std::vector<int>& keys,
+                                     const BenchConfig& config = {}) {
+    const std::vector<int> misses = absentKeys(keys);
+    std::vector<double> insertUs, hitUs, missUs, eraseUs;
+    Metrics m{};
+    PerfCounters perf(config.perfCounters);
+    PerfCounts scratch;
+
+    for (size_t i = 0; i < config.warmupRuns + config.runs; ++i) {
+        Filter filter(keys.size());
+        bool measured = i >= config.warmupRuns;
+
+        size_t failed = 0;
+        perf.start();
+        double insert = timeOps(keys, [&](int k) { failed += !filter.insert(k); });
+        perf.stop(measured ? m.insertPerf : scratch, keys.size());
+        if (failed) {
+            std::cerr << Filter::name << ": " << failed << " of " << keys.size()
+                      << " inserts failed, filter is full" << std::endl;
+            return std::nullopt;
+        }
+
+        if (i == 0) {
+            m.loadFactor = filter.loadFactor();
+            m.memory = filter.memoryUsage();
+            m.bitsPerKey = filter.bitsPerKey();
+            size_t falsePositives = 0;
+            for (int k : misses) falsePositives += filter.contains(k);
+            m.falsePositiveRate =
+                static_cast<double>(falsePositives) / misses.size();
+        }
+
+        perf.start();
+        double hit =
+            timeOps(keys, [&](int k) { doNotOptimize(filter.contains(k)); });
+        perf.stop(measured ? m.findPerf : scratch, keys.size());
+        double miss =
+            timeOps(misses, [&](int k) { doNotOptimize(filter.contains(k)); });
+        perf.start();
+        double erase =
+            timeOps(keys, [&](int k) { doNotOptimize(filter.remove(k)); });
+        perf.stop(measured ? m.erasePerf : scratch, keys.size());
+
+        if (!measured) continue;
+        insertUs.push_back(insert);
+        hitUs.push_back(hit);
+        missUs.push_back(miss);
+        eraseUs.push_back(erase);
+    }
+
+    {
+        Filter filter(keys.size());
+        measureLatency(filter, keys, m);
+    }
+
+    const double nsPerOp = 1000.0 / keys.size();
+    m.insertTime = summarize(insertUs).median;
+    m.findTime = summarize(hitUs).median;
+    m.eraseTime = summarize(eraseUs).median;
+    m.insertNs = summarize(insertUs, nsPerOp);
+    m.findHitNs = summarize(hitUs, nsPerOp);
+    m.findMissNs = summarize(missUs, nsPerOp);
+    m.eraseNs = summarize(eraseUs, nsPerOp);
+    return m;
+}
+
+// Benchmark the read-only perfect-hash set: the build from the keys takes
+// the place of the insert phase, and every run times hits and misses.
+// Insert and erase stay empty, since the set has neither.
+Metrics runFrozenTest(const std::vector<int>& keys,
+                      const BenchConfig& config = {}) {
+    const std::vector<int> misses = absentKeys(keys);
+    std::vector<double> buildUs, hitUs, missUs;
+    Metrics m{};
+    PerfCounters perf(config.perfCounters);
+    PerfCounts scratch;
+
+    for (size_t i = 0; i < config.warmupRuns + config.runs; ++i) {
+        bool measured = i >= config.warmupRuns;
+
+        auto start = std::chrono::steady_clock::now();
+        FrozenHashSet set(keys);
+        auto end = std::chrono::steady_clock::now();
+        double build =
             std::chrono::duration<double, std::micro>(end - start).count();
+
+        if (i == 0) {
+            m.loadFactor = set.loadFactor();
+            m.memory = set.memoryUsage();
+            m.bitsPerKey = set.size() ? m.memory * 8.0 / set.size() : 0.0;
+        }
+
+        perf.start();
+        double hit =
+            timeOps(keys, [&](int k) { doNotOptimize(set.contains(k)); });
+        perf.stop(measured ? m.findPerf : scratch, keys.size());
+        double miss =
+            timeOps(misses, [&](int k) { doNotOptimize(set.contains(k)); });
+
+        if (!measured) continue;
+        buildUs.push_back(build);
+        hitUs.push_back(hit);
+        missUs.push_back(miss);
+    }
+
+    {
+        FrozenHashSet set(keys);
+        LatencyHistogram find;
+        for (int k : keys) {
+            uint64_t start = readTicks();
+            doNotOptimize(set.contains(k));
+            find.record(readTicks() - start);
+        }
+        m.findLatency = find.summary();
     }
 
-    return {loadFactor,         avgChain,
-            maxChain,           totalInsert / runs,
-            totalFind / runs,   totalErase / runs,
-            mem};
+    const double nsPerOp = 1000.0 / keys.size();
+    m.findTime = summarize(hitUs).median;
+    m.buildTime = summarize(buildUs).median;
+    m.findHitNs = summarize(hitUs, nsPerOp);
+    m.findMissNs = summarize(missUs, nsPerOp);
+    return m;
+}
+
+// One phase as "median ± stddev (min)" in ns per operation
+void printOpStats(const char* label, const OpStats& s) {
+    std::cout << "  " << label << ": " << s.median << " \xC2\xB1 " << s.stddev
+              << " (min " << s.min << ")\n";
+}
+
+// Tail latencies of one phase
+void printLatency(const char* label, const LatencyStats& l) {
+    std::cout << "  " << label << ": p50 " << l.p50 << ", p90 " << l.p90
+              << ", p99 " << l.p99 << ", p999 " << l.p999 << ", max " << l.max
+              << "\n";
+}
+
+// Hardware events per operation of one phase, if any were counted
+void printPerfCounts(const char* label, const PerfCounts& p) {
+    if (!p.any()) return;
+    std::cout << "  " << label << ":";
+    for (int e = 0; e < perfEventCount; ++e)
+        if (p.valid[e]) std::cout << ' ' << perfEventNames[e] << ' ' << p.perOp(e);
+    std::cout << "\n";
+}
+
+// Probe counters, if the table kept any
+void printProbeStats(const ProbeStats& p) {
+    if (p.insert.count + p.lookup.count + p.erase.count == 0) return;
+    std::cout << "  Probes/op         : insert " << p.insert.average()
+              << ", lookup " << p.lookup.average() << ", erase "
+              << p.erase.average() << "\n";
+    std::cout << "  Probe lengths     :";
+    for (size_t i = 0; i < ProbeStats::histogramSize; ++i)
+        if (p.histogram[i])
+            std::cout << ' ' << i + 1
+                      << (i + 1 == ProbeStats::histogramSize ? "+" : "") << ':'
+                      << p.histogram[i];
+    std::cout << "\n";
+    std::cout << "  Tombstones probed : " << p.tombstonesSeen << "\n";
+    std::cout << "  Rehashes          : " << p.rehashes << " ("
+              << p.rehashNs / 1000.0 << " \xCE\xBCs)\n";
+    std::cout << "  Cleanups          : " << p.cleanups << " ("
+              << p.cleanupNs / 1000.0 << " \xCE\xBCs)\n";
 }
 
 // Pretty-print metrics to stdout
@@ -241,78 +1198,735 @@ void printMetrics(const std::string& title, const Metrics& m) {
     std::cout << "  Load factor       : " << m.loadFactor << "\n";
     std::cout << "  Avg chain length  : " << m.avgChain << "\n";
     std::cout << "  Max chain length  : " << m.maxChain << "\n";
+    std::cout << "  Avg displacement  : " << m.avgProbe << "\n";
+    std::cout << "  Max displacement  : " << m.maxProbe << "\n";
     std::cout << "  Insert time (\xCE\xBCs)  : " << m.insertTime << "\n";
     std::cout << "  Find time (\xCE\xBCs)    : " << m.findTime << "\n";
     std::cout << "  Erase time (\xCE\xBCs)   : " << m.eraseTime << "\n";
+    std::cout << "  Max insert (\xCE\xBCs)   : " << m.maxInsertTime << "\n";
+    printOpStats("Insert ns/op      ", m.insertNs);
+    printOpStats("Find hit ns/op    ", m.findHitNs);
+    printOpStats("Find miss ns/op   ", m.findMissNs);
+    printOpStats("Erase ns/op       ", m.eraseNs);
+    if (m.mixedNs.median > 0) printOpStats("Mixed ns/op       ", m.mixedNs);
+    printLatency("Insert latency ns ", m.insertLatency);
+    printLatency("Find latency ns   ", m.findLatency);
+    printLatency("Erase latency ns  ", m.eraseLatency);
+    printPerfCounts("Insert events/op  ", m.insertPerf);
+    printPerfCounts("Find events/op    ", m.findPerf);
+    printPerfCounts("Erase events/op   ", m.erasePerf);
+    printProbeStats(m.probes);
+    if (m.batchFindTime > 0)
+        std::cout << "  Batch find (\xCE\xBCs)   : " << m.batchFindTime << "\n";
+    if (m.buildTime > 0)
+        std::cout << "  Build time (\xCE\xBCs)   : " << m.buildTime << "\n";
     std::cout << "  Memory usage (B)  : " << m.memory << "\n";
+    std::cout << "  Bits per key      : " << m.bitsPerKey << "\n";
+    if (m.falsePositiveRate > 0)
+        std::cout << "  False positives   : " << m.falsePositiveRate << "\n";
+    if (m.smallTablesTime > 0)
+        std::cout << "  Small tables (\xCE\xBCs) : " << m.smallTablesTime << "\n";
+    if (m.tombstones > 0 || m.cleanups > 0)
+        std::cout << "  Tombstones        : " << m.tombstones << " ("
+                  << m.cleanups << " cleanups)\n";
 }
 
-int main() {
-    const size_t tableSize = 17; // initial prime size
+// Print a benchmarked configuration and add it to the results
+void reportVariant(ResultWriter& out, size_t numKeys,
+                   const std::string& dataset, const Variant& v,
+                   const Metrics& m) {
+    std::cout << "-- " << v.method << " Hashing (" << v.table << ", "
+              << v.capacity << ", " << v.erase << ", " << v.allocator
+              << ") --\n";
+    printMetrics("", m);
+    out.write(numKeys, dataset, v, m);
+}
 
-    std::vector<size_t> keyCounts;
-    std::cout << "Enter number(s) of keys separated by spaces: ";
-    std::string line;
-    std::getline(std::cin, line);
-    std::istringstream iss(line);
-    size_t numKeys = 0;
-    while (iss >> numKeys) {
-        if (numKeys == 0) {
-            std::cerr << "Invalid number of keys" << std::endl;
-            return 1;
+// Benchmark one table configuration and report it, if config selects it
+template <typename Table, typename Key>
+void runVariant(ResultWriter& out, size_t numKeys, const std::string& dataset,
+                const std::vector<Key>& keys, size_t tableSize,
+                const BenchConfig& config) {
+    const Variant v = variantOf<Table>();
+    if (!selected(config, v)) return;
+    reportVariant(out, numKeys, dataset, v,
+                  runTest<Table>(keys, tableSize, {}, config));
+}
+
+// Benchmark one membership filter and report it, if config selects it
+template <typename Filter>
+void runFilterVariant(ResultWriter& out, size_t numKeys,
+                      const std::string& dataset, const std::vector<int>& keys,
+                      const BenchConfig& config) {
+    const Variant v = variantOf<Filter>();
+    if (!selected(config, v)) return;
+    // Repeats of a key would overflow the filter rather than measure it
+    std::optional<Metrics> m = runFilterTest<Filter>(distinctKeys(keys), config);
+    if (m) reportVariant(out, numKeys, dataset, v, *m);
+}
+
+// Benchmark the perfect-hash set and report it, if config selects it
+void runFrozenVariant(ResultWriter& out, size_t numKeys,
+                      const std::string& dataset, const std::vector<int>& keys,
+                      const BenchConfig& config) {
+    const Variant v{FrozenHashSet::name, FibonacciHash::name, "Exact", "None",
+                    "Std"};
+    if (!selected(config, v)) return;
+    reportVariant(out, numKeys, dataset, v, runFrozenTest(keys, config));
+}
+
+// Time the bulk set operations of HashTable against the contains loop
+// they replace. One table holds the keys; the other holds every second key
+// and as many absent keys. contains_all checks the keys the two share, so
+// it never stops early. Median times over the measured runs, serially
+// and with every hardware thread.
+void runSetAlgebra(const std::vector<int>& keys, const BenchConfig& config) {
+    using Table = HashTable<FibonacciHash>;
+    if (!selected(config, variantOf<Table>())) return;
+    const std::vector<int> misses = absentKeys(keys);
+    Table a(keys.size()), b(keys.size());
+    for (int k : keys) a.insert(k);
+    for (size_t i = 0; i < keys.size(); i += 2) {
+        b.insert(keys[i]);
+        b.insert(misses[i]);
+    }
+    const Table common = a.intersect(b); // a full contains_all pass
+    const size_t threads = std::max(1u, std::thread::hardware_concurrency());
+
+    auto median = [&](auto fn) {
+        std::vector<double> us;
+        for (size_t i = 0; i < config.warmupRuns + config.runs; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            fn();
+            auto end = std::chrono::steady_clock::now();
+            if (i >= config.warmupRuns)
+                us.push_back(
+                    std::chrono::duration<double, std::micro>(end - start).count());
+        }
+        return summarize(us).median;
+    };
+    auto loop = median([&] {
+        Table result(a.size());
+        a.forEach([&](int k) {
+            if (b.contains(k)) result.insert(k);
+        });
+        doNotOptimize(result.size());
+    });
+    std::cout << "-- Set algebra (Linear, Fibonacci) --\n"
+              << "  Contains loop (\xCE\xBCs): " << loop << "\n";
+    std::vector<size_t> threadCounts = {1};
+    if (threads > 1) threadCounts.push_back(threads);
+    for (size_t t : threadCounts) {
+        double intersect = median([&] { doNotOptimize(a.intersect(b, t).size()); });
+        double difference =
+            median([&] { doNotOptimize(a.difference(b, t).size()); });
+        double containsAll =
+            median([&] { doNotOptimize(a.contains_all(common, t)); });
+        std::vector<double> mergeUs;
+        for (size_t i = 0; i < config.warmupRuns + config.runs; ++i) {
+            Table merged = a;
+            auto start = std::chrono::steady_clock::now();
+            merged.merge(b, t);
+            auto end = std::chrono::steady_clock::now();
+            if (i >= config.warmupRuns)
+                mergeUs.push_back(
+                    std::chrono::duration<double, std::micro>(end - start).count());
         }
-        keyCounts.push_back(numKeys);
+        std::cout << "  " << t << (t == 1 ? " thread " : " threads")
+                  << " (\xCE\xBCs) : intersect " << intersect << ", difference "
+                  << difference << ", merge " << summarize(mergeUs).median
+                  << ", contains_all " << containsAll << "\n";
     }
-    if (keyCounts.empty()) {
-        std::cerr << "No valid numbers provided" << std::endl;
-        return 1;
+}
+
+// Keys spelled out as strings, for the string-keyed tables
+std::vector<std::string> stringKeys(const std::vector<int>& keys) {
+    std::vector<std::string> strings;
+    strings.reserve(keys.size());
+    for (int k : keys) strings.push_back("key:" + std::to_string(k));
+    return strings;
+}
+
+// Benchmark both hashing methods with one table template
+template <template <typename, typename> class Table, typename Capacity,
+          typename Key>
+void runHashes(ResultWriter& out, size_t numKeys, const std::string& dataset,
+               const std::vector<Key>& keys, size_t tableSize,
+               const BenchConfig& config) {
+    runVariant<Table<FibonacciHash, Capacity>>(out, numKeys, dataset, keys,
+                                               tableSize, config);
+    runVariant<Table<ModuloHash, Capacity>>(out, numKeys, dataset, keys,
+                                            tableSize, config);
+}
+
+template <typename Hash, typename Capacity>
+using TombstoneHashTable = HashTable<Hash, Capacity, EraseMode::Tombstone>;
+
+template <typename Hash, typename Capacity>
+using BackwardShiftHashTable =
+    HashTable<Hash, Capacity, EraseMode::BackwardShift>;
+
+template <typename Hash, typename Capacity>
+using HugePageHashTable =
+    HashTable<Hash, Capacity, EraseMode::Tombstone, HugePageAllocator<int>>;
+
+template <typename Hash, typename Capacity>
+using PmrHashTable = HashTable<Hash, Capacity, EraseMode::Tombstone,
+                               std::pmr::polymorphic_allocator<int>>;
+
+// HashTable behind one global mutex, the baseline ConcurrentHashTable is
+// meant to replace
+class GlobalLockHashTable {
+public:
+    static constexpr const char* name = "GlobalMutex";
+
+    explicit GlobalLockHashTable(size_t capacity) : table(capacity) {}
+
+    void insert(int key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        table.insert(key);
+    }
+
+    bool contains(int key) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return table.contains(key);
+    }
+
+    bool remove(int key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return table.remove(key);
+    }
+
+private:
+    mutable std::mutex mutex;
+    HashTable<FibonacciHash> table;
+};
+
+// Run fn(begin, end) on `threads` threads, each over its own contiguous
+// slice of keys, and return the wall time in microseconds. fn may take the
+// thread's index as a third argument.
+template <typename Fn>
+double timeParallel(const std::vector<int>& keys, size_t threads, Fn fn) {
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < threads; ++t) {
+        const int* begin = keys.data() + keys.size() * t / threads;
+        const int* end = keys.data() + keys.size() * (t + 1) / threads;
+        workers.emplace_back([=] {
+            if constexpr (std::is_invocable_v<Fn&, const int*, const int*, size_t>)
+                fn(begin, end, t);
+            else
+                fn(begin, end);
+        });
+    }
+    for (auto& w : workers) w.join();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+// Time applying the queued writes of a table that batches them; 0 for the
+// others
+template <typename Table>
+double timeFlush(Table& table) {
+    if constexpr (HasFlush<Table>::value) {
+        auto start = std::chrono::steady_clock::now();
+        table.flush();
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::micro>(end - start).count();
+    } else {
+        (void)table;
+        return 0.0;
+    }
+}
+
+// Time lookups of every key by threads pinned round-robin to the NUMA
+// nodes, each reading the replica of the node hop nodes after its own
+template <typename Table>
+double timeReplicaFind(const std::vector<int>& keys, size_t threads,
+                       const Table& table, unsigned hop,
+                       std::atomic<size_t>& hits) {
+    const size_t nodes = numaNodeCount();
+    return timeParallel(keys, threads, [&](const int* b, const int* e, size_t t) {
+        unsigned node = static_cast<unsigned>(t % nodes);
+        pinThreadToNumaNode(node);
+        size_t replica = table.replicaFor(static_cast<unsigned>((node + hop) % nodes));
+        size_t found = 0;
+        for (; b != e; ++b) found += table.containsOn(replica, *b);
+        hits += found;
+    });
+}
+
+// Benchmark a thread-safe table with the keys split across threads. Tables
+// that queue writes are flushed at the end of each write phase, inside its
+// time. Rates are over config.runs measured runs, after config.warmupRuns
+// unrecorded ones.
+template <typename Table>
+ConcurrentMetrics runConcurrentTest(const std::vector<int>& keys,
+                                    size_t initialSize, size_t threads,
+                                    const BenchConfig& config) {
+    double totalInsert = 0.0;
+    double totalFind = 0.0;
+    double totalMixed = 0.0;
+    double totalErase = 0.0;
+    double totalLocal = 0.0;
+    double totalRemote = 0.0;
+
+    for (size_t i = 0; i < config.warmupRuns + config.runs; ++i) {
+        // Drop the times of the warm-up runs
+        if (i == config.warmupRuns)
+            totalInsert = totalFind = totalMixed = totalErase = totalLocal =
+                totalRemote = 0.0;
+        Table table(initialSize);
+        std::atomic<size_t> hits(0);
+        totalInsert += timeParallel(keys, threads, [&](const int* b, const int* e) {
+            for (; b != e; ++b) table.insert(*b);
+        });
+        totalInsert += timeFlush(table);
+        totalFind += timeParallel(keys, threads, [&](const int* b, const int* e) {
+            size_t found = 0;
+            for (; b != e; ++b) found += table.contains(*b);
+            hits += found;
+        });
+        if constexpr (HasReplicas<Table>::value) {
+            totalLocal += timeReplicaFind(keys, threads, table, 0, hits);
+            totalRemote += timeReplicaFind(keys, threads, table, 1, hits);
+        }
+        totalMixed += timeParallel(keys, threads, [&](const int* b, const int* e) {
+            size_t found = 0;
+            for (size_t j = 0; b + j != e; ++j) {
+                if (j % 20 == 0)
+                    j % 40 == 0 ? table.insert(b[j]) : (void)table.remove(b[j]);
+                else
+                    found += table.contains(b[j]);
+            }
+            hits += found;
+        });
+        totalMixed += timeFlush(table);
+        totalErase += timeParallel(keys, threads, [&](const int* b, const int* e) {
+            for (; b != e; ++b) table.remove(*b);
+        });
+        totalErase += timeFlush(table);
     }
 
+    // keys per microsecond equals millions of keys per second
+    double ops = static_cast<double>(keys.size()) * config.runs;
+    return {ops / totalInsert,
+            ops / totalFind,
+            ops / totalMixed,
+            ops / totalErase,
+            totalLocal > 0 ? ops / totalLocal : 0.0,
+            totalRemote > 0 ? ops / totalRemote : 0.0};
+}
+
+// Thread counts to benchmark: powers of two up to the hardware threads
+std::vector<size_t> benchmarkThreadCounts() {
+    size_t hw = std::max<size_t>(2, std::thread::hardware_concurrency());
+    std::vector<size_t> counts;
+    for (size_t t = 1; t <= hw; t *= 2) counts.push_back(t);
+    return counts;
+}
+
+// Benchmark one concurrent table at every thread count, if config selects
+// it. The hash list does not apply: these tables always hash by Fibonacci.
+template <typename Table>
+void runConcurrentVariant(ResultWriter& out, size_t numKeys,
+                          const std::string& dataset,
+                          const std::vector<int>& keys, size_t tableSize,
+                          const BenchConfig& config) {
+    if (!selected(config, {Table::name, FibonacciHash::name, "", "", ""}))
+        return;
+    std::cout << "-- " << Table::name
+              << " (Mops/s insert / find / mixed / erase) --\n";
+    const std::vector<size_t> threadCounts = config.threadCounts.empty()
+                                                 ? benchmarkThreadCounts()
+                                                 : config.threadCounts;
+    for (size_t threads : threadCounts) {
+        ConcurrentMetrics m = runConcurrentTest<Table>(keys, tableSize, threads, config);
+        std::cout << "  " << std::setw(2) << threads << " threads : "
+                  << m.insertMops << " / " << m.findMops << " / "
+                  << m.mixedMops << " / " << m.eraseMops;
+        if (m.localFindMops > 0)
+            std::cout << " (find local " << m.localFindMops << ", remote "
+                      << m.remoteFindMops << ")";
+        std::cout << "\n";
+        out.writeConcurrent(numKeys, dataset, Table::name, threads, m);
+    }
+}
+
+// Workload generators. Every generator returns non-negative keys, so the
+// negative keys of absentKeys stay misses, and is deterministic in n.
+
+// Uniformly random keys
+std::vector<int> uniformKeys(size_t n) {
     std::mt19937 rng(42);
-    std::uniform_int_distribution<int> dist(0, 1u << 30);
+    std::uniform_int_distribution<int> dist(0, 1 << 30);
+    std::vector<int> keys(n);
+    for (int& k : keys) k = dist(rng);
+    return keys;
+}
 
-    std::ofstream csv("results.csv");
-    if (!csv) {
-        std::cerr << "Failed to open results.csv" << std::endl;
-        return 1;
+// 0, 1, 2, ...
+std::vector<int> sequentialKeys(size_t n) {
+    std::vector<int> keys(n);
+    for (size_t i = 0; i < n; ++i) keys[i] = static_cast<int>(i);
+    return keys;
+}
+
+// Runs of ten consecutive keys with gaps of ten between them
+std::vector<int> clusteredKeys(size_t n) {
+    std::vector<int> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        int base = static_cast<int>((i / 10) * 20);
+        keys[i] = base + static_cast<int>(i % 10);
     }
-    csv << std::fixed << std::setprecision(2);
-    csv << "NumKeys,Dataset,Method,LoadFactor,AverageCluster,MaxCluster,InsertTime(us),";
-    csv << "FindTime(us),EraseTime(us),Memory(B)\n";
+    return keys;
+}
 
-    for (size_t numKeys : keyCounts) {
-        std::vector<int> randomKeys(numKeys);
-        for (size_t i = 0; i < numKeys; ++i) randomKeys[i] = dist(rng);
+// n draws from n distinct random keys where the key of rank r comes up with
+// probability proportional to 1 / (r + 1)^skew, so a few hot keys make up
+// most of the stream and repeat throughout it
+std::vector<int> zipfKeys(size_t n, double skew = 0.99) {
+    std::vector<int> universe = uniformKeys(n);
+    std::vector<double> cdf(n);
+    double total = 0.0;
+    for (size_t r = 0; r < n; ++r) cdf[r] = total += std::pow(r + 1.0, -skew);
+    std::mt19937 rng(43);
+    std::uniform_real_distribution<double> u(0.0, total);
+    std::vector<int> keys(n);
+    for (int& k : keys) {
+        size_t r = std::lower_bound(cdf.begin(), cdf.end(), u(rng)) - cdf.begin();
+        k = universe[std::min(r, n - 1)];
+    }
+    return keys;
+}
 
-        std::vector<int> sequentialKeys(numKeys);
-        for (size_t i = 0; i < numKeys; ++i) sequentialKeys[i] = static_cast<int>(i);
+// Multiples of stride. Modulo hashing into a power-of-two table only sees
+// the low bits, so these keys share a few home slots.
+std::vector<int> stridedKeys(size_t n, uint32_t stride = 1024) {
+    std::vector<int> keys(n);
+    for (size_t i = 0; i < n; ++i)
+        keys[i] = static_cast<int>(static_cast<uint32_t>(i) * stride & 0x7fffffffu);
+    return keys;
+}
+
+// Inverse of a modulo 2^32, for odd a, by Newton's iteration
+constexpr uint32_t inverseMod32(uint32_t a) {
+    uint32_t x = a; // correct to 3 bits, doubling with every step
+    for (int i = 0; i < 4; ++i) x *= 2 - a * x;
+    return x;
+}
+
+// Groups of groupSize keys whose Fibonacci products agree in the top 20
+// bits, so every group lands on one home slot of any power-of-two table up
+// to 2^20 slots. The keys are the inverse image of chosen products, which
+// makes them look random to modulo hashing.
+std::vector<int> adversarialKeys(size_t n, size_t groupSize = 32) {
+    const uint32_t fib = 2654435769u;
+    const uint32_t inverse = inverseMod32(fib);
+    const unsigned lowBits = 32 - 20;
+    std::mt19937 rng(44);
+    std::vector<int> keys;
+    keys.reserve(n);
+    while (keys.size() < n) {
+        uint32_t prefix = rng() & ~((uint32_t(1) << lowBits) - 1);
+        // Half of the preimages are negative as ints, so step through the
+        // low bits until the group is full of non-negative keys
+        for (uint32_t low = 0, added = 0;
+             low < (uint32_t(1) << lowBits) && added < groupSize &&
+             keys.size() < n;
+             ++low) {
+            uint32_t key = (prefix | low) * inverse;
+            if (key & 0x80000000u) continue;
+            keys.push_back(static_cast<int>(key));
+            ++added;
+        }
+    }
+    return keys;
+}
 
-        std::vector<int> clusteredKeys(numKeys);
-        for (size_t i = 0; i < numKeys; ++i) {
-            int base = static_cast<int>((i / 10) * 20);
-            clusteredKeys[i] = base + static_cast<int>(i % 10);
+// Keys recorded in a text file, as whitespace-separated integers; a '#'
+// starts a comment running to the end of the line. At most limit keys are
+// read. Returns false if the file cannot be read or holds a negative or
+// malformed key.
+bool loadKeyTrace(const std::string& path, size_t limit, std::vector<int>& keys) {
+    std::ifstream in(path);
+    if (!in) return false;
+    keys.clear();
+    std::string line;
+    while (keys.size() < limit && std::getline(in, line)) {
+        std::istringstream fields(line.substr(0, line.find('#')));
+        std::string field;
+        while (keys.size() < limit && fields >> field) {
+            char* end = nullptr;
+            long long key = std::strtoll(field.c_str(), &end, 10);
+            if (*end != '\0' || key < 0 || key > INT32_MAX) return false;
+            keys.push_back(static_cast<int>(key));
         }
+    }
+    return true;
+}
+
+// Settings of one benchmark batch, from the command line or a config file
+struct BenchOptions {
+    BenchConfig config;
+    std::vector<size_t> keyCounts; // read from stdin if none are given
+    std::vector<std::string> datasets;
+    std::string tracePath;
+    std::string csvPath = "results.csv";
+    std::string mtCsvPath = "results_mt.csv";
+    std::string jsonPath; // no JSON output if empty
+};
+
+// Comma-separated items of list
+std::vector<std::string> splitList(const std::string& list) {
+    std::vector<std::string> items;
+    std::istringstream in(list);
+    std::string item;
+    while (std::getline(in, item, ','))
+        if (!item.empty()) items.push_back(item);
+    return items;
+}
+
+// text as a number of at least min; false if it is not one
+bool parseCount(const std::string& text, size_t min, size_t& value) {
+    char* end = nullptr;
+    unsigned long long parsed = std::strtoull(text.c_str(), &end, 10);
+    if (text.empty() || text[0] == '-' || *end != '\0' || parsed < min)
+        return false;
+    value = static_cast<size_t>(parsed);
+    return true;
+}
 
+bool parseCounts(const std::string& list, size_t min,
+                 std::vector<size_t>& values) {
+    values.clear();
+    for (const std::string& item : splitList(list)) {
+        size_t value = 0;
+        if (!parseCount(item, min, value)) return false;
+        values.push_back(value);
+    }
+    return !values.empty();
+}
+
+// text as R:W:E, the percentages of lookups, inserts and erases in the
+// mixed phase; each within 0..100 and together 100
+bool parseMix(const std::string& text, BenchConfig& config) {
+    std::istringstream in(text);
+    std::string field;
+    unsigned* percents[] = {&config.readPercent, &config.writePercent,
+                            &config.erasePercent};
+    size_t parsed[3] = {};
+    for (size_t i = 0; i < 3; ++i)
+        if (!std::getline(in, field, ':') || !parseCount(field, 0, parsed[i]) ||
+            parsed[i] > 100)
+            return false;
+    if (std::getline(in, field) || parsed[0] + parsed[1] + parsed[2] != 100)
+        return false;
+    for (size_t i = 0; i < 3; ++i)
+        *percents[i] = static_cast<unsigned>(parsed[i]);
+    return true;
+}
+
+const char* const usage =
+    " [--keys N,...] [--datasets NAME,...]"
+    " [--tables NAME[/CAP[/ERASE[/ALLOC]]],...] [--hashes NAME,...]"
+    " [--threads N,...] [--runs N] [--warmup N] [--perf]"
+    " [--mix R:W:E] [--trace FILE] [--csv FILE] [--mt-csv FILE]"
+    " [--json FILE] [--config FILE]";
+
+// Read a config file: the same options as the command line, separated by
+// whitespace or newlines, with '#' starting a comment
+bool readConfigFile(const std::string& path, std::vector<std::string>& args) {
+    std::ifstream in(path);
+    if (!in) return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream words(line.substr(0, line.find('#')));
+        std::string word;
+        while (words >> word) args.push_back(word);
+    }
+    return true;
+}
+
+// Apply args to options. On failure, error describes the bad argument.
+bool parseOptions(const std::vector<std::string>& args, BenchOptions& options,
+                  std::string& error, int depth = 0) {
+    BenchConfig& config = options.config;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        if (arg == "--perf") {
+            config.perfCounters = true;
+            continue;
+        }
+        if (i + 1 == args.size()) {
+            error = "Unknown option or missing value: " + arg;
+            return false;
+        }
+        const std::string& value = args[++i];
+        bool valid = true;
+        if (arg == "--runs") {
+            valid = parseCount(value, 1, config.runs);
+        } else if (arg == "--warmup") {
+            valid = parseCount(value, 0, config.warmupRuns);
+        } else if (arg == "--keys") {
+            valid = parseCounts(value, 1, options.keyCounts);
+        } else if (arg == "--threads") {
+            valid = parseCounts(value, 1, config.threadCounts);
+        } else if (arg == "--datasets") {
+            options.datasets = splitList(value);
+        } else if (arg == "--tables") {
+            config.tables = splitList(value);
+        } else if (arg == "--hashes") {
+            config.hashes = splitList(value);
+        } else if (arg == "--mix") {
+            valid = parseMix(value, config);
+        } else if (arg == "--trace") {
+            options.tracePath = value;
+        } else if (arg == "--csv") {
+            options.csvPath = value;
+        } else if (arg == "--mt-csv") {
+            options.mtCsvPath = value;
+        } else if (arg == "--json") {
+            options.jsonPath = value;
+        } else if (arg == "--config") {
+            std::vector<std::string> fileArgs;
+            if (depth > 4 || !readConfigFile(value, fileArgs)) {
+                error = "Failed to read config file " + value;
+                return false;
+            }
+            if (!parseOptions(fileArgs, options, error, depth + 1)) return false;
+        } else {
+            error = "Unknown option: " + arg;
+            return false;
+        }
+        if (!valid) {
+            error = "Invalid value for " + arg;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Usage: see the usage string; every option is optional
+int main(int argc, char** argv) {
+    const size_t tableSize = 17; // initial size, rounded up by each policy
+
+    BenchOptions options;
+    std::string error;
+    if (!parseOptions(std::vector<std::string>(argv + 1, argv + argc), options,
+                      error)) {
+        std::cerr << error << "\nUsage: " << argv[0] << usage << std::endl;
+        return 1;
+    }
+    const BenchConfig& config = options.config;
+    const std::string& tracePath = options.tracePath;
+
+    std::vector<size_t>& keyCounts = options.keyCounts;
+    if (keyCounts.empty()) {
+        std::cout << "Enter number(s) of keys separated by spaces: ";
+        std::string line;
+        std::getline(std::cin, line);
+        std::istringstream iss(line);
+        size_t numKeys = 0;
+        while (iss >> numKeys) {
+            if (numKeys == 0) {
+                std::cerr << "Invalid number of keys" << std::endl;
+                return 1;
+            }
+            keyCounts.push_back(numKeys);
+        }
+        if (keyCounts.empty()) {
+            std::cerr << "No valid numbers provided" << std::endl;
+            return 1;
+        }
+    }
+
+    ResultWriter out;
+    if (!out.open(options.csvPath, options.mtCsvPath, options.jsonPath, error)) {
+        std::cerr << "Failed to open " << error << std::endl;
+        return 1;
+    }
+
+    for (size_t requestedKeys : keyCounts) {
         struct Dataset {
             std::string name;
-            std::vector<int>* data;
-        } datasets[] = {{"Random", &randomKeys},
-                        {"Sequential", &sequentialKeys},
-                        {"Clustered", &clusteredKeys}};
+            std::vector<int> keys;
+        };
+        std::vector<Dataset> datasets = {
+            {"Random", uniformKeys(requestedKeys)},
+            {"Sequential", sequentialKeys(requestedKeys)},
+            {"Clustered", clusteredKeys(requestedKeys)},
+            {"Zipf", zipfKeys(requestedKeys)},
+            {"Strided", stridedKeys(requestedKeys)},
+            {"Adversarial", adversarialKeys(requestedKeys)}};
+        if (!tracePath.empty()) {
+            Dataset trace{"Trace", {}};
+            if (!loadKeyTrace(tracePath, requestedKeys, trace.keys) ||
+                trace.keys.empty()) {
+                std::cerr << "Failed to read keys from " << tracePath
+                          << std::endl;
+                return 1;
+            }
+            datasets.push_back(std::move(trace));
+        }
+        datasets.erase(std::remove_if(datasets.begin(), datasets.end(),
+                                      [&](const Dataset& ds) {
+                                          return !listed(options.datasets,
+                                                         ds.name);
+                                      }),
+                       datasets.end());
 
-        for (const auto& ds : datasets) {
+        for (const Dataset& ds : datasets) {
+            // A trace may hold fewer keys than requested
+            const size_t numKeys = ds.keys.size();
             std::cout << "===== Dataset: " << ds.name << " ===== (" << numKeys << " keys)\n";
-            Metrics fib = runTest(*ds.data, fibonacciHash, tableSize);
-            Metrics mod = runTest(*ds.data, moduloHash, tableSize);
-            std::cout << "-- Fibonacci Hashing --\n";
-            printMetrics("", fib);
-            writeCsv(csv, numKeys, ds.name, "Fibonacci", fib);
-            std::cout << "-- Modulo Hashing --\n";
-            printMetrics("", mod);
-            writeCsv(csv, numKeys, ds.name, "Modulo", mod);
+            runHashes<TombstoneHashTable, PowerOfTwoCapacity>(
+                out, numKeys, ds.name, ds.keys, tableSize, config);
+            runHashes<TombstoneHashTable, PrimeCapacity>(
+                out, numKeys, ds.name, ds.keys, tableSize, config);
+            runHashes<BackwardShiftHashTable, PowerOfTwoCapacity>(
+                out, numKeys, ds.name, ds.keys, tableSize, config);
+            runHashes<HugePageHashTable, PowerOfTwoCapacity>(
+                out, numKeys, ds.name, ds.keys, tableSize, config);
+            runHashes<PmrHashTable, PowerOfTwoCapacity>(
+                out, numKeys, ds.name, ds.keys, tableSize, config);
+            runHashes<IncrementalHashTable, PowerOfTwoCapacity>(
+                out, numKeys, ds.name, ds.keys, tableSize, config);
+            runHashes<RobinHoodHashTable, PowerOfTwoCapacity>(
+                out, numKeys, ds.name, ds.keys, tableSize, config);
+            runHashes<SwissHashTable, PowerOfTwoCapacity>(
+                out, numKeys, ds.name, ds.keys, tableSize, config);
+            runHashes<CuckooHashTable, PowerOfTwoCapacity>(
+                out, numKeys, ds.name, ds.keys, tableSize, config);
+            runVariant<SmallHashTable<FibonacciHash>>(
+                out, numKeys, ds.name, ds.keys, tableSize, config);
+            runVariant<SmallHashTable<ModuloHash>>(
+                out, numKeys, ds.name, ds.keys, tableSize, config);
+            runHashes<StringHashTable, PowerOfTwoCapacity>(
+                out, numKeys, ds.name, stringKeys(ds.keys), tableSize, config);
+            runFilterVariant<CuckooFilter<uint8_t>>(out, numKeys, ds.name,
+                                                    ds.keys, config);
+            runFilterVariant<CuckooFilter<uint16_t>>(out, numKeys, ds.name,
+                                                     ds.keys, config);
+            runFrozenVariant(out, numKeys, ds.name, ds.keys, config);
+            runSetAlgebra(ds.keys, config);
+            std::cout << "-- Multi-threaded --\n";
+            runConcurrentVariant<GlobalLockHashTable>(
+                out, numKeys, ds.name, ds.keys, tableSize, config);
+            runConcurrentVariant<ConcurrentHashTable<>>(
+                out, numKeys, ds.name, ds.keys, tableSize, config);
+            runConcurrentVariant<LockFreeReadHashTable<>>(
+                out, numKeys, ds.name, ds.keys, tableSize, config);
+            runConcurrentVariant<ReplicatedHashTable<>>(
+                out, numKeys, ds.name, ds.keys, tableSize, config);
             std::cout << std::endl;
         }
     }
 
+    if (!out.close()) {
+        std::cerr << "Failed to write the results" << std::endl;
+        return 1;
+    }
     return 0;
 }
@@ -0,0 +1,725 @@
+// Differential tests for the tables under fibhash/. Every table replays the
+// same random operations as a standard container and must agree with it
+// after each step. Exits non-zero if any check fails.
+
+#include "fibhash/fibhash.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory_resource>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace fibhash;
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(cond)                                                        \
+    do {                                                                   \
+        if (!(cond)) {                                                     \
+            std::printf("  %s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, \
+                        #cond);                                            \
+            ++failures;                                                    \
+        }                                                                  \
+    } while (0)
+
+struct TestCase {
+    const char* name;
+    std::function<void()> run;
+};
+
+std::vector<TestCase>& registry() {
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+struct Register {
+    Register(const char* name, std::function<void()> run) {
+        registry().push_back({name, std::move(run)});
+    }
+};
+
+#define TEST(name)                                        \
+    void name();                                          \
+    const Register register_##name(#name, name);          \
+    void name()
+
+// Keys from a small range, so that inserts and removes keep hitting the
+// same keys and the tables fill up with tombstones
+std::vector<int> keyPool(size_t n, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::vector<int> keys(n);
+    for (auto& k : keys) k = static_cast<int>(rng());
+    return keys;
+}
+
+// Replay random inserts and removes on table and on a std::set, comparing
+// every remove result, the size, and every key of the pool at checkpoints
+template <typename Table>
+void churn(Table& table, size_t ops = 200000, size_t poolSize = 4096) {
+    std::vector<int> pool = keyPool(poolSize, 7);
+    std::set<int> expected;
+    std::mt19937 rng(11);
+    for (size_t i = 0; i < ops; ++i) {
+        int key = pool[rng() % pool.size()];
+        if (rng() % 2) {
+            table.insert(key);
+            expected.insert(key);
+        } else {
+            bool removed = table.remove(key);
+            CHECK(removed == (expected.erase(key) == 1));
+        }
+        if (i % (ops / 8) == 0 || i + 1 == ops) {
+            CHECK(table.size() == expected.size());
+            for (int k : pool) CHECK(table.contains(k) == (expected.count(k) == 1));
+        }
+    }
+}
+
+// Grow from a tiny capacity, then empty the table again
+template <typename Table>
+void growAndDrain(Table& table) {
+    std::vector<int> keys = keyPool(50000, 3);
+    std::set<int> expected(keys.begin(), keys.end());
+    for (int k : keys) table.insert(k);
+    CHECK(table.size() == expected.size());
+    for (int k : keys) CHECK(table.contains(k));
+    for (int k : expected) CHECK(table.remove(k));
+    CHECK(table.size() == 0);
+    for (int k : keys) CHECK(!table.contains(k));
+}
+
+template <typename Table>
+void tableTests() {
+    {
+        Table table(1024);
+        churn(table);
+    }
+    {
+        Table table(8);
+        growAndDrain(table);
+    }
+}
+
+TEST(linear_tombstone) {
+    tableTests<HashTable<FibonacciHash>>();
+    // The churn keeps crowding the table with tombstones, so the in-place
+    // rebuild has to run and leave the keys intact
+    HashTable<FibonacciHash> table(1024);
+    churn(table);
+    CHECK(table.cleanups() > 0);
+    CHECK(!table.needsCleanup());
+}
+
+TEST(linear_backward_shift) {
+    tableTests<HashTable<FibonacciHash, PowerOfTwoCapacity,
+                         EraseMode::BackwardShift>>();
+    HashTable<FibonacciHash, PowerOfTwoCapacity, EraseMode::BackwardShift>
+        table(1024);
+    churn(table);
+    CHECK(table.tombstones() == 0);
+}
+
+TEST(linear_prime_modulo) {
+    tableTests<HashTable<ModuloHash, PrimeCapacity>>();
+    tableTests<HashTable<FibonacciHash, PrimeCapacity>>();
+}
+
+// Replay random batches of inserts, lookups and removes on table and on a
+// std::set. Batches are drawn from a small pool, so a batch repeats keys
+// and removes the same key twice.
+template <typename Table>
+void batchChurn(Table& table) {
+    std::vector<int> pool = keyPool(2048, 17);
+    std::set<int> expected;
+    std::mt19937 rng(18);
+    std::vector<int> batch;
+    std::vector<uint8_t> out;
+    for (int round = 0; round < 400; ++round) {
+        batch.resize(1 + rng() % 300);
+        for (int& k : batch) k = pool[rng() % pool.size()];
+        out.assign(batch.size(), 2);
+        switch (rng() % 3) {
+        case 0:
+            table.insert_batch(batch.data(), batch.size());
+            expected.insert(batch.begin(), batch.end());
+            break;
+        case 1:
+            // A repeated key is only removed by its first occurrence
+            table.remove_batch(batch.data(), batch.size(), out.data());
+            for (size_t i = 0; i < batch.size(); ++i)
+                CHECK(out[i] == (expected.erase(batch[i]) == 1));
+            break;
+        default:
+            table.contains_batch(batch.data(), batch.size(), out.data());
+            for (size_t i = 0; i < batch.size(); ++i)
+                CHECK(out[i] == expected.count(batch[i]));
+        }
+        CHECK(table.size() == expected.size());
+    }
+    table.remove_batch(pool.data(), pool.size());
+    CHECK(table.size() == 0);
+    out.assign(pool.size(), 2);
+    table.contains_batch(pool.data(), pool.size(), out.data());
+    CHECK(std::count(out.begin(), out.end(), 0) ==
+          static_cast<std::ptrdiff_t>(pool.size()));
+}
+
+TEST(batch_ops) {
+    {
+        HashTable<FibonacciHash> table(8);
+        batchChurn(table);
+    }
+    {
+        HashTable<FibonacciHash, PowerOfTwoCapacity, EraseMode::BackwardShift>
+            table(8);
+        batchChurn(table);
+        CHECK(table.tombstones() == 0);
+    }
+    {
+        HashTable<ModuloHash, PrimeCapacity> table(8);
+        batchChurn(table);
+    }
+}
+
+TEST(cache_aligned_allocator) {
+    // The block is aligned and its reported size covers the aligning line
+    CacheAlignedAllocator<uint64_t> alloc;
+    for (size_t n : {1, 7, 8, 1000}) {
+        uint64_t* p = alloc.allocate(n);
+        CHECK(reinterpret_cast<uintptr_t>(p) % cacheLineSize == 0);
+        CHECK(CacheAlignedAllocator<uint64_t>::allocationSize(n) >=
+              n * sizeof(uint64_t) + cacheLineSize);
+        alloc.deallocate(p, n);
+    }
+    HashTable<FibonacciHash> table(1024);
+    CHECK(table.memoryUsage() >= table.capacity() * sizeof(uint64_t) +
+                                     cacheLineSize);
+}
+
+TEST(allocators) {
+    // Blocks from a caller's pmr resource, both arena and pool
+    using PmrTable = HashTable<FibonacciHash, PowerOfTwoCapacity,
+                               EraseMode::Tombstone,
+                               std::pmr::polymorphic_allocator<int>>;
+    {
+        std::pmr::monotonic_buffer_resource arena;
+        PmrTable table(1024, FibonacciHash(), &arena);
+        churn(table);
+        PmrTable grown(8, FibonacciHash(), &arena);
+        growAndDrain(grown);
+    }
+    {
+        std::pmr::unsynchronized_pool_resource pool;
+        PmrTable table(8, FibonacciHash(), &pool);
+        growAndDrain(table);
+    }
+
+    // Small blocks fall back to cache-aligned ones; a slot array of 2 MiB
+    // and more is mapped on a huge-page boundary
+    using HugeTable = HashTable<FibonacciHash, PowerOfTwoCapacity,
+                                EraseMode::Tombstone, HugePageAllocator<int>>;
+    tableTests<HugeTable>();
+    HugeTable table(1 << 18);
+    std::vector<int> keys = keyPool(150000, 19);
+    std::set<int> expected(keys.begin(), keys.begin() + 100000);
+    for (int k : expected) table.insert(k);
+#if defined(FIBHASH_HAVE_MMAP)
+    CHECK(table.memoryUsage() >= hugePageSize);
+    CHECK(table.memoryUsage() % hugePageSize == 0);
+#endif
+    CHECK(table.size() == expected.size());
+    for (int k : keys) CHECK(table.contains(k) == (expected.count(k) == 1));
+}
+
+TEST(incremental) {
+    tableTests<IncrementalHashTable<FibonacciHash>>();
+    // Tombstones are dropped by migrations, which must also finish
+    IncrementalHashTable<FibonacciHash> table(1024);
+    churn(table, 400000);
+    CHECK(table.memoryUsage() <= 2 * 4096 * 8 * 2);
+
+    // Lookups move the migration forward as well
+    IncrementalHashTable<FibonacciHash> grown(64);
+    for (int k = 0; k < 45; ++k) grown.insert(k);
+    CHECK(grown.migrating());
+    for (int i = 0; i < 64 && grown.migrating(); ++i) grown.contains(i);
+    CHECK(!grown.migrating());
+    for (int k = 0; k < 45; ++k) CHECK(grown.contains(k));
+}
+
+TEST(incremental_latency) {
+    // No insert may pay for a whole generation: neither the migration nor
+    // freeing the old array. Each insert keeps its fastest time over a few
+    // identical runs to filter out preemption, and the slowest of the last
+    // doubling must stay close to the slowest of an early one.
+    const size_t n = size_t(1) << 21;
+    std::vector<float> best(n, 1e30f);
+    for (int run = 0; run < 3; ++run) {
+        IncrementalHashTable<FibonacciHash> table(1024);
+        for (size_t i = 0; i < n; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            table.insert(static_cast<int>(i));
+            auto end = std::chrono::steady_clock::now();
+            best[i] = std::min(
+                best[i], std::chrono::duration<float, std::micro>(end - start).count());
+        }
+    }
+    float early = *std::max_element(best.begin() + (1 << 14), best.begin() + (1 << 16));
+    float late = *std::max_element(best.begin() + n / 2, best.end());
+    // Sanitizer allocators scrub and poison large blocks when freeing them
+#if !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__)
+    CHECK(late <= 10 * early + 250);
+#else
+    (void)early;
+    (void)late;
+#endif
+}
+
+TEST(robin_hood) { tableTests<RobinHoodHashTable<FibonacciHash>>(); }
+
+TEST(swiss) { tableTests<SwissHashTable<FibonacciHash>>(); }
+
+TEST(cuckoo) { tableTests<CuckooHashTable<FibonacciHash>>(); }
+
+TEST(small) {
+    tableTests<SmallHashTable<FibonacciHash>>();
+    // Stay below the inline capacity, spill, then return to the array
+    SmallHashTable<FibonacciHash> table;
+    churn(table, 20000, SmallHashTable<FibonacciHash>::inlineCapacity);
+    table.clear();
+    churn(table, 20000, 64);
+    table.clear();
+    CHECK(table.size() == 0);
+    churn(table, 20000, 8);
+}
+
+TEST(concurrent) {
+    tableTests<ConcurrentHashTable<>>();
+    tableTests<LockFreeReadHashTable<>>();
+}
+
+// Every thread churns its own slice of the key space, so the final
+// contents are known; readers look keys up while the writers resize
+template <typename Table>
+void concurrentChurn() {
+    const size_t threads = 4;
+    const int keysPerThread = 20000;
+    Table table(64);
+    std::atomic<bool> done(false);
+    std::thread reader([&] {
+        while (!done.load())
+            for (int k = 0; k < keysPerThread; k += 97) table.contains(k);
+    });
+    std::vector<std::thread> writers;
+    for (size_t t = 0; t < threads; ++t) {
+        writers.emplace_back([&, t] {
+            int base = static_cast<int>(t) * keysPerThread;
+            for (int k = 0; k < keysPerThread; ++k) table.insert(base + k);
+            for (int k = 0; k < keysPerThread; k += 2) table.remove(base + k);
+        });
+    }
+    for (auto& w : writers) w.join();
+    done = true;
+    reader.join();
+    CHECK(table.size() == threads * keysPerThread / 2);
+    for (int k = 0; k < static_cast<int>(threads) * keysPerThread; ++k)
+        CHECK(table.contains(k) == (k % 2 == 1));
+}
+
+TEST(concurrent_threads) {
+    concurrentChurn<ConcurrentHashTable<>>();
+    concurrentChurn<LockFreeReadHashTable<>>();
+}
+
+TEST(lock_free_read_memory) {
+    // Same-capacity rehashes must free the arrays they replace
+    LockFreeReadHashTable<> table(1024);
+    churn(table);
+    CHECK(table.memoryUsage() <= 4096 * 2 * sizeof(uint64_t));
+}
+
+TEST(replicated) {
+    std::vector<int> pool = keyPool(4096, 5);
+    ReplicatedHashTable<> table(1024, 3);
+    table.build(std::vector<int>(pool.begin(), pool.begin() + 1000));
+    std::set<int> expected(pool.begin(), pool.begin() + 1000);
+    std::mt19937 rng(2);
+    for (int round = 0; round < 20; ++round) {
+        for (int i = 0; i < 5000; ++i) {
+            int key = pool[rng() % pool.size()];
+            if (rng() % 2) {
+                table.insert(key);
+                expected.insert(key);
+            } else {
+                table.remove(key);
+                expected.erase(key);
+            }
+        }
+        table.flush();
+        CHECK(table.pendingWrites() == 0);
+        CHECK(table.size() == expected.size());
+        for (size_t r = 0; r < table.replicaCount(); ++r)
+            for (int k : pool)
+                CHECK(table.containsOn(r, k) == (expected.count(k) == 1));
+    }
+}
+
+TEST(string_table) {
+    StringHashTable<> table(64);
+    std::unordered_set<std::string> expected;
+    std::mt19937 rng(9);
+    for (int i = 0; i < 100000; ++i) {
+        // Lengths around the 8-byte chunks of the string hash
+        std::string key(rng() % 20, 'a');
+        for (auto& c : key) c = static_cast<char>('a' + rng() % 4);
+        if (rng() % 2) {
+            table.insert(key);
+            expected.insert(key);
+        } else {
+            CHECK(table.remove(key) == (expected.erase(key) == 1));
+        }
+        CHECK(table.size() == expected.size());
+    }
+    for (const auto& key : expected) CHECK(table.contains(key));
+
+    // Churn over a fixed key set never grows the table, and the same-capacity
+    // rehashes keep tombstones from filling it
+    StringHashTable<> churned(1024);
+    std::vector<std::string> pool;
+    for (int i = 0; i < 300; ++i) pool.push_back("key-" + std::to_string(i));
+    expected.clear();
+    for (int i = 0; i < 200000; ++i) {
+        const std::string& key = pool[rng() % pool.size()];
+        if (rng() % 2) {
+            churned.insert(key);
+            expected.insert(key);
+        } else {
+            CHECK(churned.remove(key) == (expected.erase(key) == 1));
+        }
+        CHECK(churned.size() + churned.tombstones() <=
+              maxOccupied * churned.capacity() + 1);
+    }
+    CHECK(churned.capacity() == 1024);
+    CHECK(churned.size() == expected.size());
+    for (const auto& key : pool)
+        CHECK(churned.contains(key) == (expected.count(key) == 1));
+}
+
+TEST(cuckoo_filter) {
+    // A filter may report absent keys, but never miss a present one
+    std::vector<int> pool = keyPool(20000, 4);
+    CuckooFilter<uint16_t> filter(pool.size());
+    std::multiset<int> present;
+    std::mt19937 rng(6);
+    for (int i = 0; i < 100000; ++i) {
+        int key = pool[rng() % pool.size()];
+        if (rng() % 2 || present.count(key) == 0) {
+            if (filter.insert(key)) present.insert(key);
+        } else {
+            CHECK(filter.remove(key));
+            present.erase(present.find(key));
+        }
+    }
+    CHECK(filter.size() == present.size());
+    for (int k : present) CHECK(filter.contains(k));
+}
+
+TEST(frozen) {
+    std::vector<int> pool = keyPool(20000, 8);
+    std::set<int> keys(pool.begin(), pool.begin() + 10000);
+    HashTable<FibonacciHash> table(16);
+    for (int k : keys) table.insert(k);
+    for (int i = 0; i < 10000; i += 3) table.remove(pool[i]);
+    for (int i = 0; i < 10000; i += 3) keys.erase(pool[i]);
+    FrozenHashSet frozen(table);
+    CHECK(frozen.size() == keys.size());
+    for (int k : pool) CHECK(frozen.contains(k) == (keys.count(k) == 1));
+}
+
+// Looked up by the compiler; a failed search breaks the build
+constexpr int staticKeys[] = {22,   80,   443,  8080, -1,         0,
+                              7,    1000, 1001, 65535, 1 << 30, -12345,
+                              4242, 31,   9999};
+constexpr auto staticSet = makeFrozenSet(staticKeys);
+static_assert(staticSet.valid(), "seed search failed");
+static_assert(staticSet.contains(443) && staticSet.contains(-12345),
+              "stored keys are found");
+static_assert(!staticSet.contains(444) && !staticSet.contains(1),
+              "absent keys are not");
+
+TEST(static_frozen) {
+    std::set<int> keys(std::begin(staticKeys), std::end(staticKeys));
+    CHECK(staticSet.size() == keys.size());
+    for (int k : keyPool(20000, 20))
+        CHECK(staticSet.contains(k) == (keys.count(k) == 1));
+    for (int k = -20000; k <= 70000; ++k)
+        CHECK(staticSet.contains(k) == (keys.count(k) == 1));
+    for (int k : keys) CHECK(staticSet.contains(k));
+
+    // Extra slots, and the empty set
+    constexpr StaticFrozenHashSet<4, 9> roomy({3, 1, 4, 15});
+    static_assert(roomy.valid() && roomy.contains(15) && !roomy.contains(5),
+                  "spare slots keep lookups exact");
+    constexpr int none[1] = {5};
+    static_assert(makeFrozenSet(none).contains(5), "one key");
+    // Duplicates cannot be placed; the whole seed range is searched, which
+    // is too much work to ask of the compiler
+    const int twice[] = {9, 9};
+    CHECK(!makeFrozenSet(twice).valid());
+}
+
+TEST(hash_map) {
+    std::vector<int> pool = keyPool(4096, 10);
+    HashMap<int, std::string> map(16);
+    std::unordered_map<int, std::string> expected;
+    std::mt19937 rng(12);
+    for (int i = 0; i < 200000; ++i) {
+        int key = pool[rng() % pool.size()];
+        switch (rng() % 3) {
+        case 0: {
+            std::string value = std::to_string(i);
+            auto [v, inserted] = map.try_emplace(key, value);
+            auto e = expected.try_emplace(key, value);
+            CHECK(inserted == e.second);
+            CHECK(*v == e.first->second);
+            break;
+        }
+        case 1:
+            CHECK(map.erase(key) == (expected.erase(key) == 1));
+            break;
+        default: {
+            const std::string* v = map.find(key);
+            auto it = expected.find(key);
+            CHECK((v != nullptr) == (it != expected.end()));
+            if (v && it != expected.end()) CHECK(*v == it->second);
+        }
+        }
+        CHECK(map.size() == expected.size());
+    }
+    size_t visited = 0;
+    map.forEach([&](int key, const std::string& value) {
+        ++visited;
+        auto it = expected.find(key);
+        CHECK(it != expected.end() && it->second == value);
+    });
+    CHECK(visited == expected.size());
+}
+
+TEST(hash_map_copy) {
+    // Keys inserted before their tombstoned neighbours must stay reachable
+    // in the copy, and inserting them again must not add a second entry
+    HashMap<int, int> map(1024);
+    std::unordered_map<int, int> expected;
+    for (int k = 0; k < 600; ++k) {
+        map.try_emplace(k, k);
+        expected.emplace(k, k);
+    }
+    for (int k = 0; k < 600; k += 2) {
+        map.erase(k);
+        expected.erase(k);
+    }
+    HashMap<int, int> copy(map);
+    HashMap<int, int> assigned;
+    assigned = map;
+    for (HashMap<int, int>* m : {&copy, &assigned}) {
+        CHECK(m->size() == expected.size());
+        for (int k = 0; k < 600; ++k) {
+            const int* v = m->find(k);
+            CHECK((v != nullptr) == (expected.count(k) == 1));
+        }
+        for (int k = 1; k < 600; k += 2) CHECK(!m->try_emplace(k, -1).second);
+        CHECK(m->size() == expected.size());
+        for (int k = 0; k < 600; k += 2) CHECK(m->try_emplace(k, k).second);
+        CHECK(m->size() == 600);
+    }
+    // The source is untouched by the copies
+    CHECK(map.size() == expected.size());
+    CHECK(map.find(0) == nullptr && *map.find(1) == 1);
+}
+
+TEST(hash_map_stable_values) {
+    // Fill to just below the growth threshold, so the next new key rehashes
+    HashMap<int, std::string> map(64);
+    for (int k = 0; k < 44; ++k) map.try_emplace(k, std::to_string(k));
+    std::string* first = map.find(0);
+    // Existing keys, even passed by a reference into the map, never rehash
+    std::vector<const int*> stored;
+    map.forEach([&](const int& key, const std::string&) { stored.push_back(&key); });
+    for (const int* key : stored) CHECK(!map.try_emplace(*key, "x").second);
+    for (int k = 0; k < 44; ++k) CHECK(&map[k] == map.find(k));
+    CHECK(map.find(0) == first && *first == "0");
+    // A new key whose value is copied from a stored one grows the map
+    auto [v, inserted] = map.try_emplace(44, *map.find(7));
+    CHECK(inserted && *v == "7");
+    CHECK(map.size() == 45);
+    for (int k = 0; k < 45; ++k)
+        CHECK(map.find(k) && *map.find(k) == std::to_string(k == 44 ? 7 : k));
+}
+
+TEST(hash_map_erase_churn) {
+    // Churn keeps erasing and reinserting without growing the map; the
+    // tombstones must be reclaimed rather than filling every slot
+    HashMap<int, int> map(64);
+    std::mt19937 rng(13);
+    std::unordered_map<int, int> expected;
+    for (int i = 0; i < 100000; ++i) {
+        int key = static_cast<int>(rng());
+        map.try_emplace(key, i);
+        expected.emplace(key, i);
+        if (expected.size() > 20) {
+            int victim = expected.begin()->first;
+            CHECK(map.erase(victim));
+            expected.erase(victim);
+        }
+    }
+    CHECK(map.size() == expected.size());
+    for (const auto& [k, v] : expected) CHECK(map.find(k) && *map.find(k) == v);
+}
+
+TEST(build_with_tombstones) {
+    // A pre-sized table keeps its tombstones through reserve(), so build()
+    // meets keys whose probe sequences run over them
+    for (size_t threads : {1, 4}) {
+        HashTable<FibonacciHash> table(1 << 14);
+        std::vector<int> pool = keyPool(10000, 14);
+        std::set<int> expected;
+        for (int i = 0; i < 5000; ++i) {
+            table.insert(pool[i]);
+            expected.insert(pool[i]);
+        }
+        for (int i = 0; i < 5000; i += 2) {
+            table.remove(pool[i]);
+            expected.erase(pool[i]);
+        }
+        CHECK(table.tombstones() > 0);
+        // Present, removed and new keys
+        std::vector<int> input(pool.begin(), pool.end());
+        table.build(input, threads);
+        expected.insert(input.begin(), input.end());
+        CHECK(table.size() == expected.size());
+        size_t visited = 0;
+        table.forEach([&](int key) {
+            ++visited;
+            CHECK(expected.count(key) == 1);
+        });
+        CHECK(visited == expected.size());
+        for (int k : expected) CHECK(table.contains(k));
+    }
+}
+
+TEST(set_ops) {
+    using Table = HashTable<FibonacciHash>;
+    std::vector<int> pool = keyPool(30000, 15);
+    std::set<int> a(pool.begin(), pool.begin() + 20000);
+    std::set<int> b(pool.begin() + 10000, pool.end());
+    auto make = [](const std::set<int>& keys) {
+        Table t(16);
+        for (int k : keys) t.insert(k);
+        return t;
+    };
+    auto same = [](const Table& t, const std::set<int>& keys) {
+        if (t.size() != keys.size()) return false;
+        for (int k : keys)
+            if (!t.contains(k)) return false;
+        return true;
+    };
+    for (size_t threads : {1, 4}) {
+        std::set<int> both, onlyA, all = a;
+        std::set_intersection(a.begin(), a.end(), b.begin(), b.end(),
+                              std::inserter(both, both.end()));
+        std::set_difference(a.begin(), a.end(), b.begin(), b.end(),
+                            std::inserter(onlyA, onlyA.end()));
+        all.insert(b.begin(), b.end());
+        Table ta = make(a);
+        Table tb = make(b);
+        CHECK(same(ta.intersect(tb, threads), both));
+        CHECK(same(ta.difference(tb, threads), onlyA));
+        CHECK(ta.contains_all(make(both), threads));
+        CHECK(!ta.contains_all(tb, threads));
+        ta.merge(tb, threads);
+        CHECK(same(ta, all));
+    }
+}
+
+TEST(save_and_map) {
+    using Table = HashTable<FibonacciHash>;
+    std::string path =
+        (std::filesystem::temp_directory_path() / "fibhash_tests.table").string();
+    std::vector<int> pool = keyPool(20000, 16);
+    std::set<int> expected(pool.begin(), pool.begin() + 10000);
+    Table table(16);
+    for (int k : expected) table.insert(k);
+    for (int i = 0; i < 10000; i += 4) {
+        table.remove(pool[i]);
+        expected.erase(pool[i]);
+    }
+    CHECK(table.save(path));
+
+    Table::MappedView view;
+    CHECK(view.open(path));
+    CHECK(view.size() == expected.size());
+    CHECK(view.capacity() == table.capacity());
+    for (int k : pool) CHECK(view.contains(k) == (expected.count(k) == 1));
+    view.close();
+    CHECK(!view.contains(pool[1]));
+
+    // A file written with another hash is refused
+    HashTable<ModuloHash, PowerOfTwoCapacity>::MappedView other;
+    CHECK(!other.open(path));
+    CHECK(!view.open(path + ".missing"));
+
+    // Corrupt headers and cut-off files are refused
+    auto corrupted = [&](size_t offset, const void* bytes, size_t n) {
+        CHECK(table.save(path));
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(static_cast<std::streamoff>(offset));
+        file.write(static_cast<const char*>(bytes),
+                   static_cast<std::streamsize>(n));
+        file.close();
+        Table::MappedView broken;
+        return !broken.open(path);
+    };
+    const uint32_t badVersion = tableFileVersion + 1;
+    const uint64_t badCapacity = table.capacity() + 1;
+    const uint64_t badOffset = 1u << 30;
+    CHECK(corrupted(offsetof(TableFileHeader, magic), "XIBHASH", 8));
+    CHECK(corrupted(offsetof(TableFileHeader, version), &badVersion,
+                    sizeof(badVersion)));
+    CHECK(corrupted(offsetof(TableFileHeader, capacity), &badCapacity,
+                    sizeof(badCapacity)));
+    CHECK(corrupted(offsetof(TableFileHeader, slotOffset), &badOffset,
+                    sizeof(badOffset)));
+    CHECK(table.save(path));
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 8);
+    CHECK(!view.open(path));
+    std::filesystem::resize_file(path, sizeof(TableFileHeader) - 1);
+    CHECK(!view.open(path));
+    std::filesystem::remove(path);
+}
+
+} // namespace
+
+int main() {
+    for (const TestCase& test : registry()) {
+        int before = failures;
+        test.run();
+        std::printf("%-24s %s\n", test.name, failures == before ? "ok" : "FAILED");
+    }
+    if (failures) std::printf("%d checks failed\n", failures);
+    return failures ? 1 : 0;
+}